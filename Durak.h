@@ -5,16 +5,34 @@
 #include <vector>
 #include <algorithm>
 #include <random>
-#include <set>
-#include <memory>
+#include <cstdint>
+#include <array>
+#include <string>
+#include <stdexcept>
+#include "GameState.h"
+#include "DurakRules.h"
 
 #define MOVES_CHECKING
 
-class DurakState {
+// a move of any variant without loss in 16 bytes, see BasicDurakState::Move
+struct DurakMoveRecord {
+    uint64_t packed;
+    uint64_t beaten;
+
+    bool operator==(const DurakMoveRecord& other) const { return packed == other.packed && beaten == other.beaten; }
+};
+
+// The game under the rules of the variant Rules, see DurakRules.h. DurakState below is the usual game
+// of two players with 36 cards and transfers
+template<typename Rules>
+class BasicDurakState {
 public:
-    static const int numberOfCards = 36;
-    static const int numberOfSuits = 4;
-    static const int numberOfRanks = 36 / numberOfSuits;
+    static constexpr int numberOfPlayers = Rules::numberOfPlayers;
+    static constexpr int numberOfCards = Rules::numberOfCards;
+    static constexpr int numberOfSuits = Rules::numberOfSuits;
+    static constexpr int numberOfRanks = Rules::numberOfRanks;
+    static constexpr int handSize = Rules::handSize;
+    static constexpr bool transfer = Rules::transfer;
 
     struct Card {
         int n;
@@ -53,84 +71,44 @@ public:
         }
     };
 
-    static const std::string ranks[numberOfRanks];
-    static const std::string suits[numberOfSuits];
-
-    struct Move {
-        bool _null = false;
-
-        Move(): _null(true) {}
-
-        static std::shared_ptr<Move> null() { return std::make_shared<Move>(); }
-
-        bool isNull() const { return _null; }
-
-        virtual explicit operator std::string() const { return "Null move"; }
-    };
-
-    using MovePtr = std::shared_ptr<Move>;
-
-    struct AttackMove: public Move {
-        std::vector<Card> cards;
-
-        AttackMove() { _null = false; }
+    static const std::array<std::string, numberOfRanks> ranks;
+    static const std::array<std::string, numberOfSuits> suits;
 
-        explicit operator std::string() const override {
-            std::string s = "Attack move: ";
-            s += static_cast<std::string>(cards.front());
+    enum MoveKind { Attack, Defend, GiveUp, ThrowIn, Pass };
 
-            for (size_t i = 1; i < cards.size(); ++i) {
-                s += ", ";
-                s += static_cast<std::string>(cards.at(i));
-            }
+    // A move by value in 16 bytes: packMove, the kind in the top bits and the cards given away in the low ones,
+    // and for defend moves the card beaten by every beating card in increasing order of the beating cards,
+    // 6 bits each. Remitting is an attack by the defender, a defend move of no cards takes the beaten cards
+    // off the table
+    struct Move {
+        uint64_t packed = ~0ull; // the null move by default
+        uint64_t beaten = 0;
 
-            return s;
-        }
-    };
+        Move() = default;
+        Move(MoveKind kind, uint64_t cards, uint64_t beaten = 0):
+                packed(static_cast<uint64_t>(kind) << 60 | cards), beaten(beaten) {}
 
-    struct DefendMove: public Move {
-        std::vector<std::pair<Card, Card>> cards; // pairs of {what to beat, than to beat}
-        bool giveUp;
+        static Move defend(std::vector<std::pair<Card, Card>> pairs); // pairs of {what to beat, than to beat}
+        static Move null() { return Move(); }
 
-        explicit DefendMove(bool giveUp = false): giveUp(giveUp) { _null = false; }
+        bool isNull() const { return packed == ~0ull; }
 
-        explicit operator std::string() const override {
-            if (giveUp)
-                return "Giving up defend move";
-            std::string s = "Defend move:\n";
-            s += "- beat " + static_cast<std::string>(cards.front().first) + " with " +
-                 static_cast<std::string>(cards.front().second);
+        MoveKind kind() const { return static_cast<MoveKind>(packed >> 60); }
+        uint64_t cards() const { return packed & ((1ull << numberOfCards) - 1); }
+        Card beatenBy(int i) const { return Card(static_cast<int>((beaten >> (6 * i)) & 63)); } // by the i-th card
+        std::vector<std::pair<Card, Card>> pairs() const; // of a defend move, as given to defend
 
-            for (size_t i = 1; i < cards.size(); ++i) {
-                s += "\n- beat " + static_cast<std::string>(cards.at(i).first) + " with " +
-                     static_cast<std::string>(cards.at(i).second);
-            }
+        bool operator==(const Move& other) const { return packed == other.packed && beaten == other.beaten; }
+        bool operator!=(const Move& other) const { return !(*this == other); }
 
-            return s;
-        }
+        explicit operator std::string() const;
     };
 
-    struct ThrowInMove: public Move {
-        std::vector<Card> cards;
-
-        ThrowInMove() { _null = false; }
-
-        explicit operator std::string() const override {
-            std::string s = "Throw-in move: ";
-            s += cards.front();
-
-            for (size_t i = 1; i < cards.size(); ++i) {
-                s += ", ";
-                s += cards.at(i);
-            }
-
-            return s;
-        }
-    };
+    using Hands = std::array<std::vector<Card>, numberOfPlayers>; // the cards of every player
 
 private:
     std::vector<Card> deck;
-    std::vector<std::vector<Card>> hands;
+    Hands hands;
     std::vector<Card> attack;
     std::vector<std::pair<Card, Card>> defended;
     std::vector<Card> discard;
@@ -144,51 +122,191 @@ private:
     std::mt19937 rd;
 
 public:
-    const int numberOfPlayers = 2;
     int playerToMove = 1;
 
-    DurakState();
-    DurakState(std::vector<Card> deck, std::vector<std::vector<Card>> hands,
-               std::vector<Card> attack, std::vector<std::pair<Card, Card>> defended,
-               std::vector<Card> discard, int trump, bool defending, int defendingPlayer, int attackingPlayer,
-               int playerToMove);
-    DurakState(const DurakState& other);
-    DurakState(DurakState&& other) noexcept;
-    DurakState& operator=(const DurakState& other);
-
-    void makeMove(const MovePtr& m);
+    static constexpr std::mt19937::result_type defaultSeed = 5; // of the deal of BasicDurakState()
+
+    BasicDurakState();
+    explicit BasicDurakState(std::mt19937::result_type seed); // a new game dealt with the given seed
+    BasicDurakState(std::vector<Card> deck, Hands hands,
+                    std::vector<Card> attack, std::vector<std::pair<Card, Card>> defended,
+                    std::vector<Card> discard, int trump, bool defending, int defendingPlayer, int attackingPlayer,
+                    int playerToMove);
+    BasicDurakState(const BasicDurakState& other);
+    BasicDurakState(BasicDurakState&& other) noexcept;
+    BasicDurakState& operator=(const BasicDurakState& other);
+
+    void makeMove(const Move& m); // validates the move if MOVES_CHECKING is defined, use it for external input
+    void makeMoveUnchecked(const Move& m); // for the moves generated by the state itself
+    void validateMove(const Move& m) const; // throws std::runtime_error describing what is wrong with the move
     void randomizeHiddenState();
     void randomizeHiddenState(int observer);
+
+    // What the observer knows about the game: their own hand, the cards of other players they have seen,
+    // the bottom card of the deck and everything on the table. Doesn't contain the hidden cards themselves
+    class InformationSet {
+    public:
+        int observer = 1;
+        int playerToMove = 1;
+
+        BasicDurakState sample(std::mt19937& rng) const; // a random state consistent with the information set
+        void sample(BasicDurakState& state, std::mt19937& rng) const; // the same, reusing the memory of state
+        void makeMove(const Move& m); // applies what everybody sees of the move
+        bool isTerminal() const;
+        // whether the player to move may be able to make the move: exact for the observer, for another
+        // player true if the move is legal with some hand they may have
+        bool isLegal(const Move& m) const;
+
+        // equal for the information sets which differ only by renaming suits, used as the opening book key.
+        // The trump suit always becomes the first one, the others are ordered by where their cards are
+        uint64_t canonicalKey() const;
+        uint64_t canonicalMove(const Move& m) const; // packMove with the suits renamed as in canonicalKey
+        Move fromCanonicalMove(uint64_t packed) const; // the inverse, null if the observer can't make the move
+
+        // hints for the time management: a rough number of moves the observer will make till the end, and
+        // how much the position matters, highest while the last cards of the deck are being dealt
+        int expectedMoves() const;
+        double criticality() const;
+
+        // a compact binary form, every card is one byte: its number with the top bit set if it's hidden
+        void write(std::string& out) const;
+        static InformationSet read(const char* data, size_t size); // throws std::runtime_error on a bad input
+
+    private:
+        friend class BasicDurakState;
+
+        std::array<int, numberOfSuits> canonicalSuits() const; // the canonical name of every suit
+        uint64_t seenCards() const; // the mask of the cards the observer knows the places of
+
+        std::array<std::vector<Card>, numberOfPlayers> known; // cards of every player known to the observer
+        std::array<int, numberOfPlayers> handSizes = {};
+        int deckSize = 0;
+        Card trumpCard = Card(0); // the bottom card of the deck, meaningful only if the deck isn't empty
+        std::vector<Card> attack;
+        std::vector<std::pair<Card, Card>> defended;
+        std::vector<Card> discard;
+
+        int trump = -1;
+        bool defending = false;
+        int defendingPlayer = -1;
+        int attackingPlayer = -1;
+
+        void removeCard(int player, const Card& card);
+        void dealCards();
+        void nextTurn();
+    };
+
+    InformationSet informationSet() const; // information set of the player to move
+    InformationSet informationSet(int observer) const;
     double getResult(int player) const;
     bool isTerminal() const;
 
-    std::vector<MovePtr> getMoves();
-    MovePtr randomMove();
+    // Lazily materializes legal moves one by one. The moves are described by card masks until they are
+    // requested, so pulling a single move doesn't allocate the whole list.
+    // By default the moves go in order of decreasing movePriority, the shuffled variant goes in random order
+    class MoveGenerator {
+    public:
+        explicit MoveGenerator(const BasicDurakState& state, std::mt19937* shuffle = nullptr);
+
+        bool next(Move& move); // writes the next move to 'move', returns false if there are no more moves
+        size_t size() const { return candidates.size(); } // number of moves in all, including the yielded ones
 
-    const std::vector<std::vector<Card>>& getHands() const { return hands; }
+        // the description of the i-th move in the order of the generator and the move itself,
+        // for choosing among the moves without materializing them all
+        MoveKind kind(size_t i) const { return candidates.at(i).kind; }
+        uint64_t cards(size_t i) const { return candidates.at(i).cards; } // as in packMove
+        Move move(size_t i) const;
+
+    private:
+        struct Candidate {
+            MoveKind kind;
+            uint64_t cards;
+            double priority;
+        };
+
+        std::vector<Candidate> candidates;
+        size_t current = 0;
+        Move defend; // there is at most one defend move, it is built along with the candidates
+    };
+
+    MoveGenerator moveGenerator() const; // moves ordered by priority
+    MoveGenerator randomMoveGenerator(); // moves in random order
+
+    std::vector<Move> getMoves() const;
+    Move randomMove();
+    bool isLegal(const Move& m) const; // whether the move could be generated in this state
+    double movePriority(const Move& m) const; // the higher the priority the earlier the move is tried by the search
+    double movePriority(MoveKind kind, uint64_t cards) const;
+
+    static uint64_t cardsMask(const std::vector<Card>& cards);
+    static uint64_t cardsMask(const std::vector<std::pair<Card, Card>>& pairs);
+    static std::vector<Card> maskCards(uint64_t mask);
+    // the suit of every card in mask renamed by suits[suit]
+    static uint64_t renameSuits(uint64_t mask, const std::array<int, numberOfSuits>& suits);
+
+    // a move in 64 bits: the kind in the top bits and the cards mask in the low ones. Defend moves are
+    // described by the beating cards only, the generator pairs them with the attack
+    static uint64_t packMove(const Move& m);
+    Move unpackMove(uint64_t packed) const; // the legal move with the packed description or the null move
+
+    using MoveRecord = DurakMoveRecord; // packed and beaten of the move
+
+    static MoveRecord recordMove(const Move& m); // throws std::runtime_error for the null move
+    static Move restoreMove(const MoveRecord& record); // throws std::runtime_error on a bad record
+
+    const Hands& getHands() const { return hands; }
+    const std::vector<Card>& getDeck() const { return deck; }
+    const std::vector<Card>& getAttack() const { return attack; } // the cards not beaten yet
+    int getTrump() const { return trump; }
+    int getDefendingPlayer() const { return defendingPlayer; }
+    int getAttackingPlayer() const { return attackingPlayer; }
     std::string toString() const;
-    static MovePtr stringToMove(const std::string& s) ;
+    static Move stringToMove(const std::string& s) ;
+    static std::string moveToString(const Move& m); // the inverse of stringToMove
+
+    // one line without spaces: deck;hand 1;...;hand n;attack;defended;discard;trump;defending;defending player;
+    // attacking player;player to move. Cards are separated by commas, cards seen by everybody are prefixed
+    // with '+', defended pairs are written as 7S/8S
+    std::string serialize() const;
+    static BasicDurakState deserialize(const std::string& s);
+
+    // a compact binary form in the format of InformationSet::write, used by the game records
+    void write(std::string& out) const;
+    static BasicDurakState read(const char* data, size_t size); // throws std::runtime_error on a bad input
 
 private:
-    void swap(DurakState& other);
+    void swap(BasicDurakState& other);
     void nextTurn();
+    void dealCards(); // deals cards to players after the end of the turn
+    int cardCost(const Card& card) const; // cheap cards are the ones to get rid of first
+
+    // the binary forms: a byte is a card number with the top bit set if the card is hidden, a list is its size
+    // and the cards
+    static void writeCards(std::string& out, const std::vector<Card>& cards);
+    static std::vector<Card> readCards(const char*& data, const char* end);
+    static int readByte(const char*& data, const char* end);
 };
 
-DurakState::DurakState(): rd(5) {// rd(rd_dev()) {
+template<typename Rules>
+BasicDurakState<Rules>::BasicDurakState(): BasicDurakState(defaultSeed) {// rd(rd_dev()) {
+
+}
+
+template<typename Rules>
+BasicDurakState<Rules>::BasicDurakState(std::mt19937::result_type seed): rd(seed) {
     deck.reserve(numberOfCards);
     for (int i = 0; i < numberOfCards; ++i) {
         deck.emplace_back(i);
     }
     std::shuffle(deck.begin(), deck.end(), rd);
 
-    size_t _numberOfCards = 6;
     for (size_t i = 0; i < numberOfPlayers; ++i) {
-        hands.emplace_back(deck.begin() + i * _numberOfCards, deck.begin() + (i + 1) * _numberOfCards);
+        hands[i].assign(deck.begin() + i * handSize, deck.begin() + (i + 1) * handSize);
     }
 
-    deck.erase(deck.begin(), deck.begin() + _numberOfCards * numberOfPlayers);
+    deck.erase(deck.begin(), deck.begin() + handSize * numberOfPlayers);
 
-    if (numberOfPlayers * _numberOfCards >= numberOfCards) {
+    if (numberOfPlayers * handSize >= numberOfCards) {
         trump = hands.back().back().suit();
         hands.back().back().reveal();
     } else {
@@ -197,11 +315,25 @@ DurakState::DurakState(): rd(5) {// rd(rd_dev()) {
     }
 }
 
-const std::string DurakState::ranks[numberOfRanks] = {"6", "7", "8", "9", "10", "J", "Q", "K", "A"};
-// const std::string DurakState::Card::suits[numberOfSuits] = {"♠S", "♣C", "♥H", "♦D"};
-const std::string DurakState::suits[numberOfSuits] = {"S", "C", "H", "D"};
+template<typename Rules>
+const std::array<std::string, BasicDurakState<Rules>::numberOfRanks> BasicDurakState<Rules>::ranks = [] {
+    // the deck is the top ranks
+    const std::string all[] = {"2", "3", "4", "5", "6", "7", "8", "9", "10", "J", "Q", "K", "A"};
+    std::array<std::string, numberOfRanks> ranks;
+
+    for (int i = 0; i < numberOfRanks; ++i)
+        ranks[i] = all[13 - numberOfRanks + i];
+
+    return ranks;
+}();
 
-DurakState::Card::Card(const std::string& s, bool hidden): hidden(hidden) {
+// const std::string BasicDurakState::Card::suits[numberOfSuits] = {"♠S", "♣C", "♥H", "♦D"};
+template<typename Rules>
+const std::array<std::string, BasicDurakState<Rules>::numberOfSuits> BasicDurakState<Rules>::suits =
+        {"S", "C", "H", "D"};
+
+template<typename Rules>
+BasicDurakState<Rules>::Card::Card(const std::string& s, bool hidden): hidden(hidden) {
     std::string r = s.substr(0, s.size() - 1);
     std::string _suit(1, s.back());
     int suit = -1;
@@ -222,30 +354,33 @@ DurakState::Card::Card(const std::string& s, bool hidden): hidden(hidden) {
             break;
         }
 
-    if (suit == -1)
+    if (rank == -1)
         throw std::runtime_error("Bad rank in converting from string to Card");
 
     n = rank * numberOfSuits + suit;
 }
 
-DurakState::DurakState(const DurakState& other):
+template<typename Rules>
+BasicDurakState<Rules>::BasicDurakState(const BasicDurakState& other):
         deck(other.deck), hands(other.hands), attack(other.attack), defended(other.defended), discard(other.discard),
         trump(other.trump), defending(other.defending), defendingPlayer(other.defendingPlayer),
         attackingPlayer(other.attackingPlayer), rd(5), // rd(rd_dev()),
-        numberOfPlayers(other.numberOfPlayers), playerToMove(other.playerToMove) {
+        playerToMove(other.playerToMove) {
 
 }
 
-DurakState::DurakState(DurakState&& other) noexcept:
+template<typename Rules>
+BasicDurakState<Rules>::BasicDurakState(BasicDurakState&& other) noexcept:
         deck(std::move(other.deck)), hands(std::move(other.hands)), attack(std::move(other.attack)),
         defended(std::move(other.defended)), discard(std::move(other.discard)), trump(other.trump),
         defending(other.defending), defendingPlayer(other.defendingPlayer), attackingPlayer(other.attackingPlayer),
         rd(5), // rd(rd_dev()),
-        numberOfPlayers(other.numberOfPlayers), playerToMove(other.playerToMove) {
+        playerToMove(other.playerToMove) {
 
 }
 
-void DurakState::swap(DurakState& other) {
+template<typename Rules>
+void BasicDurakState<Rules>::swap(BasicDurakState& other) {
     std::swap(deck, other.deck);
     std::swap(hands, other.hands);
     std::swap(attack, other.attack);
@@ -254,252 +389,287 @@ void DurakState::swap(DurakState& other) {
     std::swap(trump, other.trump);
     std::swap(defending, other.defending);
     std::swap(defendingPlayer, other.defendingPlayer);
+    std::swap(attackingPlayer, other.attackingPlayer);
     std::swap(rd, other.rd);
     std::swap(playerToMove, other.playerToMove);
 }
 
-DurakState& DurakState::operator=(const DurakState& other) {
-    DurakState copy(other);
+template<typename Rules>
+BasicDurakState<Rules>& BasicDurakState<Rules>::operator=(const BasicDurakState& other) {
+    BasicDurakState copy(other);
     swap(copy);
     return *this;
 }
 
-void DurakState::makeMove(const std::shared_ptr<DurakState::Move>& m) {
-    std::shared_ptr<AttackMove> attackMove = std::dynamic_pointer_cast<AttackMove>(m);
+template<typename Rules>
+void BasicDurakState<Rules>::validateMove(const Move& m) const {
+    if (m.isNull())
+        return; // the null move changes nothing
 
-    if (attackMove) {
-#ifdef MOVES_CHECKING
-        if (!attack.empty() && attackMove->cards.front().rank() != attack.front().rank())
-            throw std::runtime_error("Bad attack move: can't remit using card with different rank");
+    std::vector<Card> cards = maskCards(m.cards());
 
-        for (size_t i = 1; i < attackMove->cards.size(); ++i)
-            if (attackMove->cards.front().rank() != attackMove->cards.at(i).rank())
-                throw std::runtime_error("Bad attack move: all cards should have same rank");
+    switch (m.kind()) {
+        case Attack: {
+            if (cards.empty())
+                throw std::runtime_error("Bad attack move: no cards");
 
-        if (attackMove->cards.size() + attack.size() > playerToMove % numberOfPlayers) {
-            throw std::runtime_error("Bad attack move: cannot remit "
-            + std::to_string(attackMove->cards.size() + attack.size()) + " cards to a player with "
-            + std::to_string(playerToMove % numberOfPlayers) + " cards");
-        }
-#endif
+            if (!transfer && defending)
+                throw std::runtime_error("Bad attack move: remitting isn't allowed in this variant");
 
-        std::vector<Card>& hand = hands.at(playerToMove - 1);
+            if (!attack.empty() && cards.front().rank() != attack.front().rank())
+                throw std::runtime_error("Bad attack move: can't remit using card with different rank");
 
-        if (attack.empty())
-            attackingPlayer = playerToMove;
+            for (size_t i = 1; i < cards.size(); ++i)
+                if (cards.front().rank() != cards.at(i).rank())
+                    throw std::runtime_error("Bad attack move: all cards should have same rank");
 
-        for (auto& card : attackMove->cards) {
-            attack.push_back(card);
+            if (cards.size() + attack.size() > hands.at(playerToMove % numberOfPlayers).size()) {
+                throw std::runtime_error("Bad attack move: cannot remit "
+                + std::to_string(cards.size() + attack.size()) + " cards to a player with "
+                + std::to_string(hands.at(playerToMove % numberOfPlayers).size()) + " cards");
+            }
 
-            auto it = std::find(hand.begin(), hand.end(), card);
-#ifdef MOVES_CHECKING
-            if (it == hand.end())
-                throw std::runtime_error("Bad attack move: player don't have card " + static_cast<std::string>(card) +
-                                         " in his hand");
-#endif
-            hand.erase(it);
+            const std::vector<Card>& hand = hands.at(playerToMove - 1);
 
-            attack.back().reveal();
-        }
+            for (const Card& card : cards)
+                if (std::find(hand.begin(), hand.end(), card) == hand.end())
+                    throw std::runtime_error("Bad attack move: player don't have card " +
+                                             static_cast<std::string>(card) + " in his hand");
 
-        defending = true;
-        nextTurn();
-        defendingPlayer = playerToMove;
+            return;
+        }
+        case Defend:
+        case GiveUp: {
+            if (playerToMove != defendingPlayer)
+                throw std::runtime_error("Bad defend move: current player isn't a defending player");
 
-        return;
-    }
+            if (m.kind() == GiveUp || attack.empty())
+                return;
 
-    // it isn't an attack move
+            const std::vector<Card>& hand = hands.at(defendingPlayer - 1);
+            std::vector<std::pair<Card, Card>> pairs = m.pairs();
 
-    std::shared_ptr<DefendMove> defendMove = std::dynamic_pointer_cast<DefendMove>(m);
+            for (size_t i = 0; i < pairs.size(); ++i) {
+                const std::pair<Card, Card>& p = pairs.at(i);
 
-    if (defendMove) {
-#ifdef MOVES_CHECKING
-        if (playerToMove != defendingPlayer)
-            throw std::runtime_error("Bad defend move: current player isn't a defending player");
-#endif
+                if (!p.second.beat(p.first, trump))
+                    throw std::runtime_error("Bad defend move: " + static_cast<std::string>(p.second) +
+                                             " can't beat " + static_cast<std::string>(p.first));
 
-        if (defendMove->giveUp) {
-            // moving all cards from attack and defended to defendingPlayer's hand. Dealing card to players
-            auto& hand = hands.at(defendingPlayer - 1);
+                if (std::find(attack.begin(), attack.end(), p.first) == attack.end())
+                    throw std::runtime_error(
+                            "Bad defend move: where is no card " + static_cast<std::string>(p.first)
+                            + " in attack");
 
-            std::move(attack.begin(), attack.end(), std::back_inserter(hand));
-            attack.clear();
+                if (std::find(hand.begin(), hand.end(), p.second) == hand.end())
+                    throw std::runtime_error("Bad defend move: player don't have card " +
+                                             static_cast<std::string>(p.second) + " in his hand");
 
-            for (auto& it : defended) {
-                hand.push_back(it.first);
-                hand.push_back(it.second);
+                for (size_t j = 0; j < i; ++j)
+                    if (pairs.at(j).first == p.first)
+                        throw std::runtime_error("Bad defend move: card " + static_cast<std::string>(p.first) +
+                                                 " is beaten twice");
             }
-            defended.clear();
 
-            // dealing cards
-            int total = 0;
-            for (int player = attackingPlayer, i = 0; i < numberOfPlayers;
-                 ++i, player = (player % numberOfPlayers) + 1) {
-                auto& pHand = hands.at(player - 1);
-                int toGet = 6 - static_cast<int>(pHand.size());
+            return;
+        }
+        case ThrowIn:
+        case Pass: {
+            if (playerToMove == defendingPlayer)
+                throw std::runtime_error("Bad throw-in move: defending player can't throw-in");
 
-                if (toGet <= 0)
-                    continue;
+            const std::vector<Card>& hand = hands.at(playerToMove - 1);
 
-                if (total + toGet >= deck.size()) {
-                    pHand.insert(pHand.end(), deck.begin(), deck.end() - total);
-                    total = deck.size();
-                    break;
-                } else {
-                    pHand.insert(pHand.end(), deck.end() - total - toGet, deck.end() - total);
-                    total += toGet;
+            for (const Card& c : cards) {
+                bool was = false;
+
+                for (auto& card : attack) {
+                    if (card.rank() == c.rank()) {
+                        was = true;
+                        break;
+                    }
                 }
-            }
 
-            deck.erase(deck.end() - total, deck.end());
+                if (!was) {
+                    for (auto& it : defended) {
+                        if (it.first.rank() == c.rank() || it.second.rank() == c.rank()) {
+                            was = true;
+                            break;
+                        }
+                    }
+                }
 
-            defending = false;
-            defendingPlayer = -1;
-            attackingPlayer = -1;
-            nextTurn();
-        } else if (attack.empty()) {
-            // player defended against all the cards. Moving defended to discard and dealing cards to players
+                if (!was)
+                    throw std::runtime_error("Bad throw-in move: there is no card " + static_cast<std::string>(c) +
+                                             " in field");
 
-            for (auto& it : defended) {
-                discard.push_back(it.first);
-                discard.push_back(it.second);
+                if (std::find(hand.begin(), hand.end(), c) == hand.end())
+                    throw std::runtime_error(
+                            "Bad throw-in move: player don't have card " + static_cast<std::string>(c) +
+                            " in his hand");
             }
-            defended.clear();
 
-            // dealing cards
-            int total = 0;
-            for (int player = attackingPlayer, i = 0; i < numberOfPlayers;
-                 ++i, player = (player % numberOfPlayers) + 1) {
-                auto& hand = hands.at(player - 1);
-                int toGet = 6 - static_cast<int>(hand.size());
+            return;
+        }
+    }
 
-                if (toGet <= 0)
-                    continue;
+    throw std::runtime_error("Bad move: unknown kind " + std::to_string(m.kind()));
+}
 
-                if (total + toGet >= deck.size()) {
-                    hand.insert(hand.end(), deck.begin(), deck.end() - total);
-                    total = deck.size();
-                    break;
-                } else {
-                    hand.insert(hand.end(), deck.end() - total - toGet, deck.end() - total);
-                    total += toGet;
-                }
-            }
+template<typename Rules>
+void BasicDurakState<Rules>::makeMove(const Move& m) {
+#ifdef MOVES_CHECKING
+    validateMove(m);
+#endif
 
-            deck.erase(deck.end() - total, deck.end());
+    makeMoveUnchecked(m);
+}
 
-            defending = false;
-            defendingPlayer = -1;
-            attackingPlayer = -1;
-            nextTurn();
-        } else {
-            // defending
-            auto& hand = hands.at(defendingPlayer - 1);
+template<typename Rules>
+void BasicDurakState<Rules>::makeMoveUnchecked(const Move& m) {
+    if (m.isNull())
+        return; // the null move changes nothing
 
-            for (const std::pair<Card, Card>& p : defendMove->cards) {
-                if (!p.second.beat(p.first, trump))
-                    std::cout << "Can't beat!" << std::endl;
+    switch (m.kind()) {
+        case Attack: {
+            std::vector<Card>& hand = hands.at(playerToMove - 1);
 
-                auto it = std::find(attack.begin(), attack.end(), p.first);
+            if (attack.empty())
+                attackingPlayer = playerToMove;
 
-#ifdef MOVES_CHECKING
-                if (it == attack.end())
-                    throw std::runtime_error(
-                            "Bad defend move: where is no card " + static_cast<std::string>(p.first)
-                            + " in attack");
-#endif
+            for (uint64_t rest = m.cards(); rest; rest &= rest - 1) {
+                Card card(__builtin_ctzll(rest));
+                attack.push_back(card);
 
-                auto it2 = std::find(hand.begin(), hand.end(), p.second);
-#ifdef MOVES_CHECKING
-                if (it2 == hand.end())
-                    throw std::runtime_error("Bad defend move: player don't have card " +
-                                             static_cast<std::string>(p.second) + " in his hand");
-#endif
-                hand.erase(it2);
+                hand.erase(std::find(hand.begin(), hand.end(), card));
 
-                attack.erase(it);
-                defended.push_back(p);
-                defended.back().first.reveal();
-                defended.back().second.reveal();
+                attack.back().reveal();
             }
 
+            defending = true;
             nextTurn();
-        }
+            defendingPlayer = playerToMove;
 
-        return;
-    }
-    // it isn't a defend move
+            return;
+        }
+        case GiveUp: {
+            // moving all cards from attack and defended to defendingPlayer's hand. Dealing card to players
+            auto& hand = hands.at(defendingPlayer - 1);
 
-    std::shared_ptr<ThrowInMove> throwInMove = std::dynamic_pointer_cast<ThrowInMove>(m);
+            std::move(attack.begin(), attack.end(), std::back_inserter(hand));
+            attack.clear();
 
-    if (throwInMove) {
-#ifdef MOVES_CHECKING
-        if (playerToMove == defendingPlayer)
-            throw std::runtime_error("Bad throw-in move: defending player can't throw-in");
-#endif
+            for (auto& it : defended) {
+                hand.push_back(it.first);
+                hand.push_back(it.second);
+            }
+            defended.clear();
 
-        auto& hand = hands.at(playerToMove - 1);
+            dealCards();
 
-        for (const Card& c : throwInMove->cards) {
-#ifdef MOVES_CHECKING
-            bool was = false;
+            defending = false;
+            defendingPlayer = -1;
+            attackingPlayer = -1;
+            nextTurn();
 
-            for (auto& card : attack) {
-                if (card.rank() == c.rank()) {
-                    was = true;
-                    break;
+            return;
+        }
+        case Defend: {
+            if (attack.empty()) {
+                // player defended against all the cards. Moving defended to discard and dealing cards to players
+                for (auto& it : defended) {
+                    discard.push_back(it.first);
+                    discard.push_back(it.second);
+                }
+                defended.clear();
+
+                dealCards();
+
+                defending = false;
+                defendingPlayer = -1;
+                attackingPlayer = -1;
+                nextTurn();
+            } else {
+                // defending
+                auto& hand = hands.at(defendingPlayer - 1);
+                int i = 0;
+
+                for (uint64_t rest = m.cards(); rest; rest &= rest - 1, ++i) {
+                    Card beaten = m.beatenBy(i), beating(__builtin_ctzll(rest));
+                    auto it = std::find(attack.begin(), attack.end(), beaten);
+                    auto it2 = std::find(hand.begin(), hand.end(), beating);
+
+                    hand.erase(it2);
+                    attack.erase(it);
+                    defended.emplace_back(beaten, beating);
+                    defended.back().first.reveal();
+                    defended.back().second.reveal();
                 }
+
+                nextTurn();
             }
 
-            if (!was) {
-                for (auto& it : defended) {
-                    if (it.first.rank() == c.rank() || it.second.rank() == c.rank()) {
-                        was = true;
-                        break;
-                    }
-                }
+            return;
+        }
+        case ThrowIn:
+        case Pass: {
+            auto& hand = hands.at(playerToMove - 1);
+
+            for (uint64_t rest = m.cards(); rest; rest &= rest - 1) {
+                Card c(__builtin_ctzll(rest));
+                attack.push_back(c);
+                attack.back().reveal();
+
+                hand.erase(std::find(hand.begin(), hand.end(), c));
             }
 
-            if (!was)
-                throw std::runtime_error("Bad throw-in move: there is no card " + static_cast<std::string>(c) +
-                                         " in field");
-#endif
-            attack.push_back(c);
-            attack.back().reveal();
+            nextTurn();
 
-            auto it = std::find(hand.begin(), hand.end(), c);
-#ifdef MOVES_CHECKING
-            if (it == hand.end())
-                throw std::runtime_error(
-                        "Bad throw-in move: player don't have card " + static_cast<std::string>(c) +
-                        " in his hand");
-#endif
-            hand.erase(it);
+            return;
         }
+    }
+}
+
+template<typename Rules>
+void BasicDurakState<Rules>::dealCards() {
+    int total = 0;
+    for (int player = attackingPlayer, i = 0; i < numberOfPlayers;
+         ++i, player = (player % numberOfPlayers) + 1) {
+        auto& hand = hands.at(player - 1);
+        int toGet = handSize - static_cast<int>(hand.size());
 
-        nextTurn();
+        if (toGet <= 0)
+            continue;
 
-        return;
+        if (total + toGet >= deck.size()) {
+            hand.insert(hand.end(), deck.begin(), deck.end() - total);
+            total = deck.size();
+            break;
+        } else {
+            hand.insert(hand.end(), deck.end() - total - toGet, deck.end() - total);
+            total += toGet;
+        }
     }
-    // it isn't a throw-in move
 
-    // the move is _null which is weird. Don't need to do anything
+    deck.erase(deck.end() - total, deck.end());
 }
 
-void DurakState::nextTurn() {
+template<typename Rules>
+void BasicDurakState<Rules>::nextTurn() {
     playerToMove = (playerToMove % numberOfPlayers) + 1;
 }
 
-void DurakState::randomizeHiddenState() {
+template<typename Rules>
+void BasicDurakState<Rules>::randomizeHiddenState() {
     randomizeHiddenState(playerToMove);
 }
 
-void DurakState::randomizeHiddenState(int observer) {
+template<typename Rules>
+void BasicDurakState<Rules>::randomizeHiddenState(int observer) {
     // folding all hidden cards in one deck, shuffling them and dealing back
 
     // folding
-    std::vector<std::vector<Card>> newHands(hands.size());
+    Hands newHands;
 
     bool hasTrump = !deck.empty();
 
@@ -536,154 +706,617 @@ void DurakState::randomizeHiddenState(int observer) {
     hands = std::move(newHands);
 }
 
-bool DurakState::isTerminal() const {
-    return std::any_of(hands.begin(), hands.end(),
-                       [](const std::vector<Card>& hand) { return hand.empty(); });
+template<typename Rules>
+typename BasicDurakState<Rules>::InformationSet BasicDurakState<Rules>::informationSet() const {
+    return informationSet(playerToMove);
 }
 
-double DurakState::getResult(int player) const {
-    int win = 0;
-    for (size_t i = 0; i < hands.size(); ++i) {
-        if (hands.at(i).empty()) {
-            win = i + 1;
-            break;
-        }
+template<typename Rules>
+typename BasicDurakState<Rules>::InformationSet BasicDurakState<Rules>::informationSet(int observer) const {
+    InformationSet info;
+    info.observer = observer;
+    info.playerToMove = playerToMove;
+
+    for (size_t i = 0; i < numberOfPlayers; ++i) {
+        info.handSizes[i] = hands[i].size();
+
+        for (const Card& card : hands.at(i))
+            if (!card.isHidden() || observer == i + 1)
+                info.known.at(i).push_back(card);
     }
 
-    return (win == player);
+    info.deckSize = deck.size();
+    if (!deck.empty())
+        info.trumpCard = deck.front();
+
+    info.attack = attack;
+    info.defended = defended;
+    info.discard = discard;
+    info.trump = trump;
+    info.defending = defending;
+    info.defendingPlayer = defendingPlayer;
+    info.attackingPlayer = attackingPlayer;
+
+    return info;
 }
 
-std::vector<DurakState::MovePtr> DurakState::getMoves() {
-    if (isTerminal())
-        return std::vector<MovePtr>();
+template<typename Rules>
+BasicDurakState<Rules> BasicDurakState<Rules>::InformationSet::sample(std::mt19937& rng) const {
+    BasicDurakState state({}, {}, {}, {}, {}, trump, defending, defendingPlayer, attackingPlayer, playerToMove);
+    sample(state, rng);
+    return state;
+}
 
-    std::vector<MovePtr> moves;
+template<typename Rules>
+void BasicDurakState<Rules>::InformationSet::sample(BasicDurakState& state, std::mt19937& rng) const {
+    // every card the observer doesn't see is equally likely to be anywhere it's unseen
+    uint64_t seen = seenCards();
+    int unseen[numberOfCards];
+    int total = 0;
 
-    std::vector<Card>& hand = hands.at(playerToMove - 1);
+    for (int n = 0; n < numberOfCards; ++n)
+        if (!(seen & (1ull << n)))
+            unseen[total++] = n;
 
-    if (defending) {
-        if (playerToMove == defendingPlayer) {
-            // remitting, defending or giving up
+    std::shuffle(unseen, unseen + total, rng);
 
-            // remitting
-            if (std::all_of(attack.begin() + 1, attack.end(), [&attack = attack](const Card& c) {
-                return attack.front().rank() == c.rank();
-            }) && defended.empty()) {
-                std::vector<Card> remitCards;
+    int next = 0;
 
-                for (const Card& card : hand)
-                    if (card.rank() == attack.front().rank())
-                        remitCards.push_back(card);
+    for (size_t i = 0; i < numberOfPlayers; ++i) {
+        std::vector<Card>& hand = state.hands.at(i);
 
-                int limit = hands.at(playerToMove % numberOfPlayers).size();
+        hand.assign(known.at(i).begin(), known.at(i).end());
+        while (hand.size() < handSizes.at(i))
+            hand.emplace_back(unseen[next++]);
+    }
 
-                for (size_t i = 1; i < (1u << remitCards.size()); ++i) {
-                    std::shared_ptr<ThrowInMove> move = std::make_shared<ThrowInMove>();
-                    for (size_t j = 0; j < remitCards.size(); ++j)
-                        if (i & (1u << j))
-                            move->cards.push_back(remitCards.at(j));
+    state.deck.clear();
+    if (deckSize > 0) {
+        state.deck.push_back(trumpCard);
+        while (next < total)
+            state.deck.emplace_back(unseen[next++]);
+    }
 
-                    if (move->cards.size() <= limit)
-                        moves.push_back(move);
-                }
+#ifdef MOVES_CHECKING
+    // a card counted as unseen while it's in sight would be dealt twice and make the deck too large
+    if (state.deck.size() != static_cast<size_t>(deckSize))
+        throw std::runtime_error("Bad sample: a deck of " + std::to_string(state.deck.size()) + " cards instead of " +
+                                 std::to_string(deckSize));
+#endif
 
-                /*for (const Card& card : hand) {
-                    if (card.rank() == attack.front().rank()) {
-                        std::shared_ptr<AttackMove> move = std::make_shared<AttackMove>();
-                        move->cards.push_back(card);
-                        moves.push_back(move);
-                    }
-                }*/
-            }
+    state.attack.assign(attack.begin(), attack.end());
+    state.defended.assign(defended.begin(), defended.end());
+    state.discard.assign(discard.begin(), discard.end());
 
-            // giving up
-            std::shared_ptr<DefendMove> gupMove = std::make_shared<DefendMove>(true);
-            moves.push_back(gupMove);
+    state.trump = trump;
+    state.defending = defending;
+    state.defendingPlayer = defendingPlayer;
+    state.attackingPlayer = attackingPlayer;
+    state.playerToMove = playerToMove;
+}
 
-            // defending
-            std::sort(hand.begin(), hand.end(), [this](const Card& c1, const Card& c2) {
-                if (c1.suit() == trump) {
-                    if (c2.suit() == trump)
-                        return c1.rank() < c2.rank();
-                    else
-                        return false;
-                } else {
-                    if (c2.suit() == trump)
-                        return true;
-                    else if (c1.rank() == c2.rank())
-                        return c1.suit() < c2.suit();
-                    else
-                        return c1.rank() < c2.rank();
-                }
-            });
+template<typename Rules>
+uint64_t BasicDurakState<Rules>::InformationSet::seenCards() const {
+    uint64_t seen = cardsMask(attack) | cardsMask(discard);
 
-            std::vector<bool> beaten(attack.size(), false);
-            std::shared_ptr<DefendMove> move = std::make_shared<DefendMove>();
+    // both cards of a defended pair, cardsMask of the pairs has only the beating ones
+    for (const auto& [c1, c2] : defended)
+        seen |= (1ull << c1.n) | (1ull << c2.n);
 
-            for (const Card& card : hand) {
-                for (size_t i = 0; i < attack.size(); ++i) {
-                    if (!beaten.at(i) && card.beat(attack.at(i), trump)) {
-                        beaten.at(i) = true;
-                        move->cards.emplace_back(attack.at(i), card);
-                        break;
-                    }
-                }
-            }
+    for (const std::vector<Card>& cards : known)
+        seen |= cardsMask(cards);
 
-            if (std::find(beaten.begin(), beaten.end(), false) == beaten.end())
-                moves.push_back(move);
-        } else {
-            // throwing-in
-            std::vector<bool> allowedRanks(numberOfRanks, false);
+    if (deckSize > 0)
+        seen |= 1ull << trumpCard.n;
 
-            for (auto& [c1, c2] : defended) {
-                allowedRanks[c1.rank()] = true;
-                allowedRanks[c2.rank()] = true;
-            }
+    return seen;
+}
 
-            for (auto& c : attack)
-                allowedRanks[c.rank()] = true;
+template<typename Rules>
+bool BasicDurakState<Rules>::InformationSet::isLegal(const Move& m) const {
+    if (isTerminal())
+        return false;
+
+    // BasicDurakState::isLegal in a state where the player to move holds every card they may hold. The other
+    // hands matter only by their sizes, so they are padded with any cards
+    BasicDurakState state({}, {}, attack, defended, {}, trump, defending, defendingPlayer, attackingPlayer,
+                          playerToMove);
+
+    for (int i = 0; i < numberOfPlayers; ++i) {
+        std::vector<Card>& hand = state.hands[i];
+        hand = known[i];
+
+        if (i + 1 == playerToMove && playerToMove != observer) {
+            std::vector<Card> unseen = maskCards(((1ull << numberOfCards) - 1) & ~seenCards());
+            hand.insert(hand.end(), unseen.begin(), unseen.end());
+        } else if (hand.size() < static_cast<size_t>(handSizes[i])) {
+            hand.resize(handSizes[i], Card(0));
+        }
+    }
 
-            std::vector<std::vector<Card>> cardsByRanks(numberOfRanks);
+    return state.isLegal(m);
+}
 
-            for (auto& card : hand)
-                if (allowedRanks[card.rank()])
-                    cardsByRanks.at(card.rank()).push_back(card);
+template<typename Rules>
+void BasicDurakState<Rules>::InformationSet::makeMove(const Move& m) {
+    if (m.isNull())
+        return;
 
-            for (auto& rank : cardsByRanks) {
-                for (size_t i = 1; i < (1u << rank.size()); ++i) {
-                    std::shared_ptr<ThrowInMove> move = std::make_shared<ThrowInMove>();
-                    for (size_t j = 0; j < rank.size(); ++j)
-                        if (i & (1u << j))
-                            move->cards.push_back(rank.at(j));
-                    moves.push_back(move);
-                }
+    switch (m.kind()) {
+        case Attack:
+            if (attack.empty())
+                attackingPlayer = playerToMove;
+
+            for (uint64_t rest = m.cards(); rest; rest &= rest - 1) {
+                Card card(__builtin_ctzll(rest));
+                removeCard(playerToMove, card);
+                attack.push_back(card);
+                attack.back().reveal();
             }
 
-            /*for (auto& card : hand) {
-                bool added = false;
-                for (auto&[c1, c2] : defended)
-                    if (card.rank() == c1.rank() || card.rank() == c2.rank()) {
-                        std::shared_ptr<ThrowInMove> move = std::make_shared<ThrowInMove>();
-                        move->cards.push_back(card);
-                        moves.push_back(move);
-                        added = true;
-                        break;
-                    }
+            defending = true;
+            nextTurn();
+            defendingPlayer = playerToMove;
+            break;
+        case GiveUp: {
+            // the defender takes everything from the table, so all these cards are known
+            std::vector<Card>& hand = known.at(defendingPlayer - 1);
+
+            hand.insert(hand.end(), attack.begin(), attack.end());
+            for (const auto& [c1, c2] : defended) {
+                hand.push_back(c1);
+                hand.push_back(c2);
+            }
 
-                if (added)
-                    continue;
+            handSizes.at(defendingPlayer - 1) += attack.size() + 2 * defended.size();
+            attack.clear();
+            defended.clear();
+            dealCards();
 
-                for (auto& c : attack)
-                    if (c.rank() == card.rank()) {
-                        std::shared_ptr<ThrowInMove> move = std::make_shared<ThrowInMove>();
-                        move->cards.push_back(card);
-                        moves.push_back(move);
-                        break;
-                    }
-            }*/
+            defending = false;
+            defendingPlayer = -1;
+            attackingPlayer = -1;
+            nextTurn();
+            break;
+        }
+        case Defend:
+            if (attack.empty()) {
+                for (const auto& [c1, c2] : defended) {
+                    discard.push_back(c1);
+                    discard.push_back(c2);
+                }
+
+                defended.clear();
+                dealCards();
+
+                defending = false;
+                defendingPlayer = -1;
+                attackingPlayer = -1;
+            } else {
+                int i = 0;
+
+                for (uint64_t rest = m.cards(); rest; rest &= rest - 1, ++i) {
+                    Card beaten = m.beatenBy(i), beating(__builtin_ctzll(rest));
+                    removeCard(defendingPlayer, beating);
+                    attack.erase(std::find(attack.begin(), attack.end(), beaten));
+                    defended.emplace_back(beaten, beating);
+                    defended.back().first.reveal();
+                    defended.back().second.reveal();
+                }
+            }
+
+            nextTurn();
+            break;
+        case ThrowIn:
+        case Pass:
+            for (uint64_t rest = m.cards(); rest; rest &= rest - 1) {
+                Card card(__builtin_ctzll(rest));
+                removeCard(playerToMove, card);
+                attack.push_back(card);
+                attack.back().reveal();
+            }
+
+            nextTurn();
+            break;
+    }
+}
+
+template<typename Rules>
+bool BasicDurakState<Rules>::InformationSet::isTerminal() const {
+    return std::any_of(handSizes.begin(), handSizes.end(), [](int size) { return size == 0; });
+}
+
+template<typename Rules>
+void BasicDurakState<Rules>::InformationSet::removeCard(int player, const Card& card) {
+    std::vector<Card>& hand = known.at(player - 1);
+    auto it = std::find(hand.begin(), hand.end(), card);
+
+    if (it != hand.end())
+        hand.erase(it);
+
+    handSizes.at(player - 1) -= 1;
+}
+
+template<typename Rules>
+void BasicDurakState<Rules>::InformationSet::dealCards() {
+    // the same as BasicDurakState::dealCards, but only the bottom card of the deck is known
+    int total = 0;
+    for (int player = attackingPlayer, i = 0; i < numberOfPlayers; ++i, player = (player % numberOfPlayers) + 1) {
+        int toGet = handSize - handSizes.at(player - 1);
+
+        if (toGet <= 0)
+            continue;
+
+        if (total + toGet >= deckSize) {
+            handSizes.at(player - 1) += deckSize - total;
+
+            if (deckSize > total)
+                known.at(player - 1).push_back(trumpCard);
+
+            total = deckSize;
+            break;
+        } else {
+            handSizes.at(player - 1) += toGet;
+            total += toGet;
+        }
+    }
+
+    deckSize -= total;
+}
+
+template<typename Rules>
+void BasicDurakState<Rules>::InformationSet::nextTurn() {
+    playerToMove = (playerToMove % numberOfPlayers) + 1;
+}
+
+template<typename Rules>
+std::array<int, BasicDurakState<Rules>::numberOfSuits> BasicDurakState<Rules>::InformationSet::canonicalSuits() const {
+    // every suit is described by the ranks it has in each place the observer sees, suits with equal
+    // descriptions are interchangeable, so any order between them gives the same key
+    std::vector<std::vector<Card>> places;
+    const int players = numberOfPlayers;
+
+    for (int i = 0; i < players; ++i)
+        places.push_back(known.at((observer - 1 + i) % players));
+
+    places.push_back(deckSize > 0 ? std::vector<Card>{trumpCard} : std::vector<Card>{});
+    places.push_back(attack);
+    places.push_back(discard);
+    places.emplace_back();
+    places.emplace_back();
+
+    for (const auto& [c1, c2] : defended) {
+        places.at(places.size() - 2).push_back(c1);
+        places.back().push_back(c2);
+    }
+
+    std::array<std::vector<int>, numberOfSuits> descriptions;
+
+    for (const std::vector<Card>& cards : places) {
+        std::array<int, numberOfSuits> ranks = {};
+
+        for (const Card& c : cards)
+            ranks[c.suit()] |= 1 << c.rank();
+
+        for (int suit = 0; suit < numberOfSuits; ++suit)
+            descriptions[suit].push_back(ranks[suit]);
+    }
+
+    std::array<int, numberOfSuits> order = {};
+    for (int suit = 0; suit < numberOfSuits; ++suit)
+        order[suit] = suit;
+
+    std::stable_sort(order.begin(), order.end(), [this, &descriptions](int a, int b) {
+        if ((a == trump) != (b == trump))
+            return a == trump;
+
+        return descriptions[a] > descriptions[b];
+    });
+
+    std::array<int, numberOfSuits> suits = {};
+    for (int i = 0; i < numberOfSuits; ++i)
+        suits[order[i]] = i;
+
+    return suits;
+}
+
+template<typename Rules>
+uint64_t BasicDurakState<Rules>::InformationSet::canonicalKey() const {
+    std::array<int, numberOfSuits> suits = canonicalSuits();
+    const int players = numberOfPlayers;
+    uint64_t key = 0;
+
+    // splitmix64 over everything the observer knows, the players are numbered starting from the observer
+    auto add = [&key](uint64_t value) {
+        key ^= value + 0x9e3779b97f4a7c15ull + (key << 6) + (key >> 2);
+        key ^= key >> 30;
+        key *= 0xbf58476d1ce4e5b9ull;
+        key ^= key >> 27;
+        key *= 0x94d049bb133111ebull;
+        key ^= key >> 31;
+    };
+
+    auto relative = [this, players](int player) {
+        return player < 1 ? -1 : (player - observer + players) % players;
+    };
+
+    add(players);
+    add(relative(playerToMove));
+    add(defending);
+    add(relative(defendingPlayer) + 1);
+    add(relative(attackingPlayer) + 1);
+    add(deckSize);
+
+    for (int i = 0; i < players; ++i) {
+        int player = (observer - 1 + i) % players;
+        add(handSizes.at(player));
+        add(renameSuits(cardsMask(known.at(player)), suits));
+    }
+
+    if (deckSize > 0)
+        add(renameSuits(1ull << trumpCard.n, suits));
+
+    add(renameSuits(cardsMask(attack), suits));
+    add(renameSuits(cardsMask(discard), suits));
+
+    std::vector<uint64_t> pairs;
+    for (const auto& [c1, c2] : defended)
+        pairs.push_back(__builtin_ctzll(renameSuits(1ull << c1.n, suits)) * numberOfCards +
+                        __builtin_ctzll(renameSuits(1ull << c2.n, suits)));
+
+    std::sort(pairs.begin(), pairs.end());
+    for (uint64_t pair : pairs)
+        add(pair);
+
+    return key;
+}
+
+template<typename Rules>
+uint64_t BasicDurakState<Rules>::InformationSet::canonicalMove(const Move& m) const {
+    uint64_t packed = packMove(m);
+    uint64_t cards = packed & ((1ull << numberOfCards) - 1);
+
+    return (packed ^ cards) | renameSuits(cards, canonicalSuits());
+}
+
+template<typename Rules>
+typename BasicDurakState<Rules>::Move BasicDurakState<Rules>::InformationSet::fromCanonicalMove(uint64_t packed) const {
+    if (observer != playerToMove || isTerminal())
+        return Move::null();
+
+    std::array<int, numberOfSuits> suits = canonicalSuits();
+    std::array<int, numberOfSuits> inverse = {};
+
+    for (int suit = 0; suit < numberOfSuits; ++suit)
+        inverse[suits[suit]] = suit;
+
+    uint64_t cards = packed & ((1ull << numberOfCards) - 1);
+
+    // the moves depend only on the hand of the player to move, which is the observer, and on the table
+    std::mt19937 rng(5);
+    return sample(rng).unpackMove((packed ^ cards) | renameSuits(cards, inverse));
+}
+
+template<typename Rules>
+int BasicDurakState<Rules>::InformationSet::expectedMoves() const {
+    // the observer gets about half of the deck, and in self-play there are about two moves per card:
+    // passes, taking and defending make many moves which don't get rid of a card
+    return 4 + 2 * (handSizes.at(observer - 1) + deckSize / 2);
+}
+
+template<typename Rules>
+double BasicDurakState<Rules>::InformationSet::criticality() const {
+    // when the deck runs out the hidden cards become few and the game turns into an endgame, the moves
+    // deciding who gets the last cards matter most
+    if (deckSize > 0 && deckSize <= 2 * numberOfPlayers)
+        return 2.0;
+
+    if (deckSize == 0)
+        return 1.5;
+
+    return 1.0;
+}
+
+template<typename Rules>
+void BasicDurakState<Rules>::InformationSet::write(std::string& out) const {
+    auto writeCards = [&out](const std::vector<Card>& cards) { BasicDurakState::writeCards(out, cards); };
+
+    out.push_back(static_cast<char>(numberOfPlayers));
+    out.push_back(static_cast<char>(observer));
+    out.push_back(static_cast<char>(playerToMove));
+
+    for (size_t i = 0; i < numberOfPlayers; ++i) {
+        out.push_back(static_cast<char>(handSizes.at(i)));
+        writeCards(known.at(i));
+    }
+
+    out.push_back(static_cast<char>(deckSize));
+    writeCards({trumpCard});
+    writeCards(attack);
+
+    std::vector<Card> pairs;
+    for (const auto& [c1, c2] : defended) {
+        pairs.push_back(c1);
+        pairs.push_back(c2);
+    }
+
+    writeCards(pairs);
+    writeCards(discard);
+
+    out.push_back(static_cast<char>(trump));
+    out.push_back(static_cast<char>(defending));
+    out.push_back(static_cast<char>(defendingPlayer));
+    out.push_back(static_cast<char>(attackingPlayer));
+}
+
+template<typename Rules>
+typename BasicDurakState<Rules>::InformationSet BasicDurakState<Rules>::InformationSet::read(const char* data,
+                                                                                                size_t size) {
+    const char* end = data + size;
+    auto readByte = [&data, end]() { return BasicDurakState::readByte(data, end); };
+    auto readCards = [&data, end]() { return BasicDurakState::readCards(data, end); };
+
+    InformationSet info;
+    int players = readByte();
+    info.observer = readByte();
+    info.playerToMove = readByte();
+
+    if (players != numberOfPlayers)
+        throw std::runtime_error("Bad information set: " + std::to_string(players) + " players");
+
+    for (int i = 0; i < players; ++i) {
+        info.handSizes[i] = readByte();
+        info.known[i] = readCards();
+    }
+
+    info.deckSize = readByte();
+
+    std::vector<Card> trumpCard = readCards();
+    if (trumpCard.size() != 1)
+        throw std::runtime_error("Bad information set: no trump card");
 
-            moves.push_back(std::make_shared<ThrowInMove>());
+    info.trumpCard = trumpCard.front();
+    info.attack = readCards();
+
+    std::vector<Card> pairs = readCards();
+    for (size_t i = 0; i + 1 < pairs.size(); i += 2)
+        info.defended.emplace_back(pairs.at(i), pairs.at(i + 1));
+
+    info.discard = readCards();
+    info.trump = readByte();
+    info.defending = readByte() != 0;
+    info.defendingPlayer = readByte();
+    info.attackingPlayer = readByte();
+
+    return info;
+}
+
+template<typename Rules>
+bool BasicDurakState<Rules>::isTerminal() const {
+    return std::any_of(hands.begin(), hands.end(),
+                       [](const std::vector<Card>& hand) { return hand.empty(); });
+}
+
+template<typename Rules>
+double BasicDurakState<Rules>::getResult(int player) const {
+    int win = 0;
+    for (size_t i = 0; i < hands.size(); ++i) {
+        if (hands.at(i).empty()) {
+            win = i + 1;
+            break;
+        }
+    }
+
+    return (win == player);
+}
+
+template<typename Rules>
+BasicDurakState<Rules>::MoveGenerator::MoveGenerator(const BasicDurakState& state, std::mt19937* shuffle) {
+    if (state.isTerminal())
+        return;
+
+    const std::vector<Card>& hand = state.hands.at(state.playerToMove - 1);
+    size_t limit = state.hands.at(state.playerToMove % state.numberOfPlayers).size();
+
+    // adds every non-empty subset of the same-rank cards which isn't bigger than limit
+    auto addSubsets = [this](MoveKind kind, const std::vector<Card>& cards, size_t limit) {
+        for (size_t i = 1; i < (1u << cards.size()); ++i) {
+            uint64_t mask = 0;
+            size_t size = 0;
+
+            for (size_t j = 0; j < cards.size(); ++j)
+                if (i & (1u << j)) {
+                    mask |= 1ull << cards.at(j).n;
+                    ++size;
+                }
+
+            if (size <= limit)
+                candidates.push_back({kind, mask, 0});
+        }
+    };
+
+    if (state.defending) {
+        if (state.playerToMove == state.defendingPlayer) {
+            // remitting, defending or giving up
+            const std::vector<Card>& attack = state.attack;
+
+            // remitting
+            if (transfer && !attack.empty() && state.defended.empty() &&
+                std::all_of(attack.begin() + 1, attack.end(), [&attack](const Card& c) {
+                return attack.front().rank() == c.rank();
+            })) {
+                std::vector<Card> remitCards;
+
+                for (const Card& card : hand)
+                    if (card.rank() == attack.front().rank())
+                        remitCards.push_back(card);
+
+                if (limit > attack.size())
+                    addSubsets(Attack, remitCards, limit - attack.size());
+            }
+
+            // giving up
+            candidates.push_back({GiveUp, 0, 0});
+
+            // defending
+            std::vector<Card> sorted(hand);
+            int trump = state.trump;
+
+            std::sort(sorted.begin(), sorted.end(), [trump](const Card& c1, const Card& c2) {
+                if (c1.suit() == trump) {
+                    if (c2.suit() == trump)
+                        return c1.rank() < c2.rank();
+                    else
+                        return false;
+                } else {
+                    if (c2.suit() == trump)
+                        return true;
+                    else if (c1.rank() == c2.rank())
+                        return c1.suit() < c2.suit();
+                    else
+                        return c1.rank() < c2.rank();
+                }
+            });
+
+            std::vector<bool> beaten(attack.size(), false);
+            std::vector<std::pair<Card, Card>> pairs;
+
+            for (const Card& card : sorted) {
+                for (size_t i = 0; i < attack.size(); ++i) {
+                    if (!beaten.at(i) && card.beat(attack.at(i), trump)) {
+                        beaten.at(i) = true;
+                        pairs.emplace_back(attack.at(i), card);
+                        break;
+                    }
+                }
+            }
+
+            if (std::find(beaten.begin(), beaten.end(), false) == beaten.end()) {
+                defend = Move::defend(std::move(pairs));
+                candidates.push_back({Defend, defend.cards(), 0});
+            }
+        } else {
+            // throwing-in
+            std::vector<bool> allowedRanks(numberOfRanks, false);
+
+            for (auto& [c1, c2] : state.defended) {
+                allowedRanks[c1.rank()] = true;
+                allowedRanks[c2.rank()] = true;
+            }
+
+            for (auto& c : state.attack)
+                allowedRanks[c.rank()] = true;
+
+            std::vector<std::vector<Card>> cardsByRanks(numberOfRanks);
+
+            for (auto& card : hand)
+                if (allowedRanks[card.rank()])
+                    cardsByRanks.at(card.rank()).push_back(card);
+
+            for (auto& rank : cardsByRanks)
+                addSubsets(ThrowIn, rank, rank.size());
+
+            candidates.push_back({Pass, 0, 0});
         }
     } else {
         // attacking
@@ -693,35 +1326,425 @@ std::vector<DurakState::MovePtr> DurakState::getMoves() {
             cardsByRanks.at(card.rank()).push_back(card);
         }
 
-        for (auto& rank : cardsByRanks) {
-            for (size_t i = 1; i < (1u << rank.size()); ++i) {
-                std::shared_ptr<AttackMove> move = std::make_shared<AttackMove>();
-                for (size_t j = 0; j < rank.size(); ++j)
-                    if (i & (1u << j))
-                        move->cards.push_back(rank.at(j));
-                moves.push_back(move);
-            }
-        }
+        for (auto& rank : cardsByRanks)
+            addSubsets(Attack, rank, limit);
+    }
 
-        /*for (auto& card : hand) {
-            std::shared_ptr<AttackMove> move = std::make_shared<AttackMove>();
-            move->cards.push_back(card);
-            moves.push_back(move);
-        }*/
+    if (shuffle) {
+        std::shuffle(candidates.begin(), candidates.end(), *shuffle);
+    } else {
+        for (Candidate& c : candidates)
+            c.priority = state.movePriority(c.kind, c.cards);
+
+        std::stable_sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+            return a.priority > b.priority;
+        });
     }
+}
+
+template<typename Rules>
+bool BasicDurakState<Rules>::MoveGenerator::next(Move& move) {
+    if (current == candidates.size())
+        return false;
+
+    move = this->move(current++);
+    return true;
+}
+
+template<typename Rules>
+typename BasicDurakState<Rules>::Move BasicDurakState<Rules>::MoveGenerator::move(size_t i) const {
+    const Candidate& c = candidates.at(i);
+    return c.kind == Defend ? defend : Move(c.kind, c.cards);
+}
+
+template<typename Rules>
+typename BasicDurakState<Rules>::MoveGenerator BasicDurakState<Rules>::moveGenerator() const {
+    return MoveGenerator(*this);
+}
+
+template<typename Rules>
+typename BasicDurakState<Rules>::MoveGenerator BasicDurakState<Rules>::randomMoveGenerator() {
+    return MoveGenerator(*this, &rd);
+}
+
+template<typename Rules>
+std::vector<typename BasicDurakState<Rules>::Move> BasicDurakState<Rules>::getMoves() const {
+    std::vector<Move> moves;
+    MoveGenerator generator = moveGenerator();
+    Move move;
+
+    while (generator.next(move))
+        moves.push_back(move);
 
     return moves;
 }
 
-DurakState::MovePtr DurakState::randomMove() {
-    if (isTerminal())
+template<typename Rules>
+typename BasicDurakState<Rules>::Move BasicDurakState<Rules>::randomMove() {
+    MoveGenerator generator = randomMoveGenerator();
+    Move move;
+
+    if (!generator.next(move))
         return Move::null();
 
-    std::vector<MovePtr> moves = getMoves();
-    return moves[rd() % moves.size()];
+    return move;
+}
+
+template<typename Rules>
+bool BasicDurakState<Rules>::isLegal(const Move& m) const {
+    if (isTerminal() || m.isNull())
+        return false;
+
+    uint64_t hand = cardsMask(hands.at(playerToMove - 1));
+    uint64_t cards = m.cards();
+
+    // card n is rank * numberOfSuits + suit, so the lowest and the highest cards have the extreme ranks
+    int rank = cards ? Card(__builtin_ctzll(cards)).rank() : -1;
+    bool sameRank = !cards || Card(63 - __builtin_clzll(cards)).rank() == rank;
+
+    switch (m.kind()) {
+        case Attack: {
+            size_t size = __builtin_popcountll(cards);
+            size_t limit = hands.at(playerToMove % numberOfPlayers).size();
+
+            if (!cards || !sameRank || (cards & ~hand))
+                return false;
+
+            if (!defending)
+                return size <= limit;
+
+            // remitting
+            return transfer && playerToMove == defendingPlayer && !attack.empty() && defended.empty() &&
+                   size + attack.size() <= limit &&
+                   std::all_of(attack.begin(), attack.end(), [rank](const Card& c) { return c.rank() == rank; });
+        }
+        case GiveUp:
+            return defending && playerToMove == defendingPlayer && !cards;
+        case Defend: {
+            if (!defending || playerToMove != defendingPlayer || (cards & ~hand))
+                return false;
+
+            // all the attacking cards must be beaten with different cards from the hand
+            if (static_cast<size_t>(__builtin_popcountll(cards)) != attack.size())
+                return false;
+
+            uint64_t beaten = 0;
+            int i = 0;
+
+            for (uint64_t rest = cards; rest; rest &= rest - 1, ++i) {
+                Card c1 = m.beatenBy(i), c2(__builtin_ctzll(rest));
+
+                if (!c2.beat(c1, trump) || std::find(attack.begin(), attack.end(), c1) == attack.end() ||
+                    (beaten & (1ull << c1.n)))
+                    return false;
+
+                beaten |= 1ull << c1.n;
+            }
+
+            return true;
+        }
+        case ThrowIn:
+        case Pass: {
+            if (!defending || playerToMove == defendingPlayer)
+                return false;
+
+            if (!cards)
+                return true;
+
+            if (!sameRank || (cards & ~hand))
+                return false;
+
+            return std::any_of(attack.begin(), attack.end(), [rank](const Card& c) { return c.rank() == rank; }) ||
+                   std::any_of(defended.begin(), defended.end(), [rank](const std::pair<Card, Card>& p) {
+                       return p.first.rank() == rank || p.second.rank() == rank;
+                   });
+        }
+    }
+
+    return false;
+}
+
+template<typename Rules>
+int BasicDurakState<Rules>::cardCost(const Card& card) const {
+    return card.rank() + (card.suit() == trump ? numberOfRanks : 0);
+}
+
+template<typename Rules>
+double BasicDurakState<Rules>::movePriority(MoveKind kind, uint64_t cards) const {
+    // cheap single cards come first, every additional card of the same rank is tried later,
+    // giving up is the last resort
+    double cost = 0;
+    int size = 0;
+
+    for (uint64_t rest = cards; rest; rest &= rest - 1, ++size)
+        cost += cardCost(Card(__builtin_ctzll(rest)));
+
+    double priority = size ? -cost / size - (size - 1) : 0;
+
+    switch (kind) {
+        case Attack:
+        case ThrowIn:
+            return priority;
+        case Defend:
+            return priority + (size ? size - 1 : 0);
+        case Pass:
+            return -numberOfRanks;
+        case GiveUp:
+            return -4 * numberOfRanks;
+    }
+
+    return -8 * numberOfRanks;
+}
+
+template<typename Rules>
+double BasicDurakState<Rules>::movePriority(const Move& m) const {
+    return m.isNull() ? -8 * numberOfRanks : movePriority(m.kind(), m.cards());
+}
+
+template<typename Rules>
+uint64_t BasicDurakState<Rules>::cardsMask(const std::vector<Card>& cards) {
+    uint64_t mask = 0;
+
+    for (const Card& c : cards)
+        mask |= 1ull << c.n;
+
+    return mask;
+}
+
+template<typename Rules>
+uint64_t BasicDurakState<Rules>::cardsMask(const std::vector<std::pair<Card, Card>>& pairs) {
+    // only the cards which are used to beat
+    uint64_t mask = 0;
+
+    for (const auto& p : pairs)
+        mask |= 1ull << p.second.n;
+
+    return mask;
+}
+
+template<typename Rules>
+std::vector<typename BasicDurakState<Rules>::Card> BasicDurakState<Rules>::maskCards(uint64_t mask) {
+    std::vector<Card> cards;
+
+    for (uint64_t rest = mask; rest; rest &= rest - 1)
+        cards.emplace_back(__builtin_ctzll(rest));
+
+    return cards;
+}
+
+template<typename Rules>
+uint64_t BasicDurakState<Rules>::renameSuits(uint64_t mask, const std::array<int, numberOfSuits>& suits) {
+    uint64_t renamed = 0;
+
+    for (uint64_t rest = mask; rest; rest &= rest - 1) {
+        Card card(__builtin_ctzll(rest));
+        renamed |= 1ull << Card(suits[card.suit()], card.rank()).n;
+    }
+
+    return renamed;
+}
+
+template<typename Rules>
+uint64_t BasicDurakState<Rules>::packMove(const Move& m) {
+    if (m.isNull())
+        throw std::runtime_error("Null move can't be packed");
+
+    return m.packed;
+}
+
+template<typename Rules>
+typename BasicDurakState<Rules>::Move BasicDurakState<Rules>::unpackMove(uint64_t packed) const {
+    MoveGenerator generator = moveGenerator();
+    Move move;
+
+    while (generator.next(move))
+        if (packMove(move) == packed)
+            return move;
+
+    return Move::null();
+}
+
+template<typename Rules>
+void BasicDurakState<Rules>::write(std::string& out) const {
+    out.push_back(static_cast<char>(numberOfPlayers));
+    out.push_back(static_cast<char>(playerToMove));
+
+    writeCards(out, deck);
+    for (const std::vector<Card>& hand : hands)
+        writeCards(out, hand);
+
+    writeCards(out, attack);
+
+    std::vector<Card> pairs;
+    for (const auto& [c1, c2] : defended) {
+        pairs.push_back(c1);
+        pairs.push_back(c2);
+    }
+
+    writeCards(out, pairs);
+    writeCards(out, discard);
+
+    out.push_back(static_cast<char>(trump));
+    out.push_back(static_cast<char>(defending));
+    out.push_back(static_cast<char>(defendingPlayer));
+    out.push_back(static_cast<char>(attackingPlayer));
+}
+
+template<typename Rules>
+BasicDurakState<Rules> BasicDurakState<Rules>::read(const char* data, size_t size) {
+    const char* end = data + size;
+
+    int players = readByte(data, end);
+    int playerToMove = readByte(data, end);
+
+    if (players != numberOfPlayers)
+        throw std::runtime_error("Bad state: " + std::to_string(players) + " players");
+
+    std::vector<Card> deck = readCards(data, end);
+    Hands hands;
+    for (int i = 0; i < players; ++i)
+        hands[i] = readCards(data, end);
+
+    std::vector<Card> attack = readCards(data, end);
+    std::vector<Card> pairs = readCards(data, end);
+    std::vector<std::pair<Card, Card>> defended;
+    for (size_t i = 0; i + 1 < pairs.size(); i += 2)
+        defended.emplace_back(pairs.at(i), pairs.at(i + 1));
+
+    std::vector<Card> discard = readCards(data, end);
+    int trump = readByte(data, end);
+    bool defending = readByte(data, end) != 0;
+    int defendingPlayer = readByte(data, end);
+    int attackingPlayer = readByte(data, end);
+
+    return BasicDurakState(std::move(deck), std::move(hands), std::move(attack), std::move(defended),
+                           std::move(discard), trump, defending, defendingPlayer, attackingPlayer, playerToMove);
+}
+
+template<typename Rules>
+void BasicDurakState<Rules>::writeCards(std::string& out, const std::vector<Card>& cards) {
+    out.push_back(static_cast<char>(cards.size()));
+
+    for (const Card& c : cards)
+        out.push_back(static_cast<char>(c.n | (c.isHidden() ? 0x80 : 0)));
+}
+
+template<typename Rules>
+std::vector<typename BasicDurakState<Rules>::Card> BasicDurakState<Rules>::readCards(const char*& data,
+                                                                                  const char* end) {
+    int count = readByte(data, end);
+    std::vector<Card> cards;
+
+    for (int i = 0; i < count; ++i) {
+        int c = readByte(data, end) & 0xff;
+
+        if ((c & 0x7f) >= numberOfCards)
+            throw std::runtime_error("Bad card " + std::to_string(c & 0x7f) + " in binary data");
+
+        cards.emplace_back(c & 0x7f, (c & 0x80) != 0);
+    }
+
+    return cards;
+}
+
+template<typename Rules>
+int BasicDurakState<Rules>::readByte(const char*& data, const char* end) {
+    if (data == end)
+        throw std::runtime_error("Unexpected end of binary data");
+
+    return static_cast<signed char>(*data++);
+}
+
+template<typename Rules>
+typename BasicDurakState<Rules>::MoveRecord BasicDurakState<Rules>::recordMove(const Move& m) {
+    if (m.isNull())
+        throw std::runtime_error("Null move can't be recorded");
+
+    return {m.packed, m.beaten};
+}
+
+template<typename Rules>
+typename BasicDurakState<Rules>::Move BasicDurakState<Rules>::restoreMove(const MoveRecord& record) {
+    Move m;
+    m.packed = record.packed;
+    m.beaten = record.beaten;
+
+    if (m.isNull() || m.kind() > Pass)
+        throw std::runtime_error("Bad move record");
+
+    return m;
+}
+
+template<typename Rules>
+typename BasicDurakState<Rules>::Move BasicDurakState<Rules>::Move::defend(std::vector<std::pair<Card, Card>> pairs) {
+    std::sort(pairs.begin(), pairs.end(), [](const auto& a, const auto& b) {
+        return a.second < b.second;
+    });
+
+    Move move(Defend, 0);
+
+    for (size_t i = 0; i < pairs.size(); ++i) {
+        move.packed |= 1ull << pairs.at(i).second.n;
+        move.beaten |= static_cast<uint64_t>(pairs.at(i).first.n) << (6 * i);
+    }
+
+    return move;
+}
+
+template<typename Rules>
+std::vector<std::pair<typename BasicDurakState<Rules>::Card, typename BasicDurakState<Rules>::Card>>
+BasicDurakState<Rules>::Move::pairs() const {
+    std::vector<std::pair<Card, Card>> pairs;
+    int i = 0;
+
+    for (uint64_t rest = cards(); rest; rest &= rest - 1, ++i)
+        pairs.emplace_back(beatenBy(i), Card(__builtin_ctzll(rest)));
+
+    return pairs;
+}
+
+template<typename Rules>
+BasicDurakState<Rules>::Move::operator std::string() const {
+    if (isNull())
+        return "Null move";
+
+    std::vector<Card> cards = maskCards(this->cards());
+    std::string s;
+
+    auto list = [&s, &cards]() {
+        for (size_t i = 0; i < cards.size(); ++i)
+            s += (i ? ", " : "") + static_cast<std::string>(cards.at(i));
+
+        return s;
+    };
+
+    switch (kind()) {
+        case Attack:
+            s = "Attack move: ";
+            return list();
+        case GiveUp:
+            return "Giving up defend move";
+        case Defend:
+            if (cards.empty())
+                return "Defend move: all cards are beaten";
+
+            s = "Defend move:";
+            for (const auto& [c1, c2] : pairs())
+                s += "\n- beat " + static_cast<std::string>(c1) + " with " + static_cast<std::string>(c2);
+
+            return s;
+        case ThrowIn:
+            s = "Throw-in move: ";
+            return list();
+        case Pass:
+            return "Throw-in move: pass";
+    }
+
+    return "Bad move";
 }
 
-std::string DurakState::toString() const {
+template<typename Rules>
+std::string BasicDurakState<Rules>::toString() const {
     if (isTerminal()) {
         std::string s;
 
@@ -794,199 +1817,222 @@ std::string DurakState::toString() const {
     }
 }
 
-DurakState::MovePtr DurakState::stringToMove(const std::string& _s) {
+template<typename Rules>
+typename BasicDurakState<Rules>::Move BasicDurakState<Rules>::stringToMove(const std::string& _s) {
+    if (_s.empty())
+        throw std::runtime_error("Empty move description");
+
     char first = _s.front();
-    std::string s = _s.substr(2, _s.size() - 2);
+    std::string s = _s.size() > 2 ? _s.substr(2, _s.size() - 2) : "";
 
-    if (first == 'A') {
-        // attack move
-        std::shared_ptr<AttackMove> move = std::make_shared<AttackMove>();
-        int last = -1;
+    std::vector<Card> cards;
+    uint64_t mask = 0;
+    int last = -1;
 
-        for (int i = 0; i <= s.size(); ++i) {
+    if (s.substr(0, 6) != "GIVEUP") {
+        for (int i = 0; i <= s.size() && !s.empty(); ++i) {
             if (i == s.size() || s.at(i) == ' ') {
-                move->cards.emplace_back(s.substr(last + 1, i - last - 1));
+                cards.emplace_back(s.substr(last + 1, i - last - 1));
                 last = i;
             }
         }
+    }
 
-        return move;
-    } else if (first == 'D') {
-        // defend move
-        std::shared_ptr<DefendMove> move = std::make_shared<DefendMove>();
+    auto add = [&mask](const Card& c) {
+        if (mask & (1ull << c.n))
+            throw std::runtime_error("Card " + static_cast<std::string>(c) + " is used twice in the move");
 
-        if (s.substr(0, 6) == "GIVEUP") {
-            move->giveUp = true;
-            return move;
-        }
+        mask |= 1ull << c.n;
+    };
 
-        std::vector<Card> _cards;
-        int last = -1;
+    if (first == 'A') {
+        // attack move
+        for (const Card& c : cards)
+            add(c);
 
-        for (int i = 0; i <= s.size(); ++i) {
-            if (i == s.size() || s.at(i) == ' ') {
-                _cards.emplace_back(s.substr(last + 1, i - last - 1));
-                last = i;
-            }
-        }
+        return Move(Attack, mask);
+    } else if (first == 'D') {
+        // defend move
+        if (s.substr(0, 6) == "GIVEUP")
+            return Move(GiveUp, 0);
 
-        if (_cards.size() % 2 != 0)
+        if (cards.size() % 2 != 0)
             throw std::runtime_error("Defend move description must have even number of cards");
 
-        for (int i = 0; i < _cards.size(); i += 2)
-            move->cards.emplace_back(_cards.at(i), _cards.at(i + 1));
+        std::vector<std::pair<Card, Card>> pairs;
+
+        for (int i = 0; i < cards.size(); i += 2) {
+            add(cards.at(i + 1));
+            pairs.emplace_back(cards.at(i), cards.at(i + 1));
+        }
 
-        return move;
+        return Move::defend(std::move(pairs));
     } else if (first == 'T') {
         // throw-in move
-        std::shared_ptr<ThrowInMove> move = std::make_shared<ThrowInMove>();
-
-        int last = -1;
-
-        for (int i = 0; i <= s.size(); ++i) {
-            if (i == s.size() || s.at(i) == ' ') {
-                move->cards.emplace_back(s.substr(last + 1, i - last - 1));
-                last = i;
-            }
-        }
+        for (const Card& c : cards)
+            add(c);
 
-        return move;
+        return Move(mask ? ThrowIn : Pass, mask);
     } else
         throw std::runtime_error("Bad move type during converting string to Move");
 }
 
-DurakState::DurakState(std::vector<Card> deck, std::vector<std::vector<Card>> hands,
-                       std::vector<Card> attack, std::vector<std::pair<Card, Card>> defended,
-                       std::vector<Card> discard, int trump, bool defending, int defendingPlayer,
-                       int attackingPlayer, int playerToMove):
-        deck(std::move(deck)), hands(std::move(hands)), attack(std::move(attack)),
-        defended(std::move(defended)), discard(std::move(discard)), trump(trump), defending(defending),
-        defendingPlayer(defendingPlayer), attackingPlayer(attackingPlayer), playerToMove(playerToMove) {
+template<typename Rules>
+std::string BasicDurakState<Rules>::moveToString(const Move& m) {
+    if (m.isNull())
+        throw std::runtime_error("Null move can't be converted to string");
 
-}
+    std::string s;
 
-namespace std {
-    template<>
-    struct hash<DurakState::Card> {
-    private:
-        size_t a, b, p;
+    switch (m.kind()) {
+        case Attack:
+            s = "A";
+            break;
+        case GiveUp:
+            return "D GIVEUP";
+        case Defend:
+            s = "D";
 
-    public:
-        hash() {
-            std::mt19937 rd((std::random_device()()));
-            a = rd();
-            b = rd();
-            p = 3'313'483'909u;
-        }
+            for (const auto& [c1, c2] : m.pairs())
+                s += " " + static_cast<std::string>(c1) + " " + static_cast<std::string>(c2);
 
-        size_t operator()(const DurakState::Card& card) const {
-            return ((a * static_cast<unsigned int>(card.n)) % p + b) % p;
-        }
+            return s;
+        case ThrowIn:
+        case Pass:
+            s = "T";
+            break;
+    }
+
+    for (const Card& c : maskCards(m.cards()))
+        s += " " + static_cast<std::string>(c);
+
+    return s;
+}
+
+template<typename Rules>
+std::string BasicDurakState<Rules>::serialize() const {
+    auto card = [](const Card& c) {
+        return (c.isHidden() ? "" : "+") + static_cast<std::string>(c);
     };
 
-    template<>
-    struct hash<DurakState::Move> {
-        size_t operator()(const DurakState::Move& m) const {
-            std::hash<DurakState::Card> h;
+    auto cards = [&card](const std::vector<Card>& cards) {
+        std::string s;
 
-            try {
-                const auto& move = dynamic_cast<const DurakState::AttackMove&>(m);
+        for (size_t i = 0; i < cards.size(); ++i)
+            s += (i ? "," : "") + card(cards.at(i));
 
-                size_t value = 0;
+        return s;
+    };
 
-                for (const DurakState::Card& c : move.cards)
-                    value ^= h(c);
+    std::string s = cards(deck);
 
-                return value;
-            } catch (const std::bad_cast& ex) {
-                // it isn't an attack move
-            }
+    for (const std::vector<Card>& hand : hands)
+        s += ";" + cards(hand);
 
-            try {
-                const auto& move = dynamic_cast<const DurakState::DefendMove&>(m);
+    s += ";" + cards(attack) + ";";
 
-                size_t value = 0;
+    for (size_t i = 0; i < defended.size(); ++i)
+        s += (i ? "," : "") + card(defended.at(i).first) + "/" + card(defended.at(i).second);
 
-                for (const auto&[c1, c2] : move.cards) {
-                    value ^= h(c1);
-                    value ^= h(c2);
-                }
+    s += ";" + cards(discard);
+    s += ";" + std::to_string(trump) + ";" + std::to_string(defending) + ";" + std::to_string(defendingPlayer);
+    s += ";" + std::to_string(attackingPlayer) + ";" + std::to_string(playerToMove);
 
-                value = (value << 8u) || (value >> 24u);
+    return s;
+}
 
-                if (move.giveUp)
-                    value ^= 0b100000001u;
+template<typename Rules>
+BasicDurakState<Rules> BasicDurakState<Rules>::deserialize(const std::string& s) {
+    auto split = [](const std::string& s, char delimiter) {
+        std::vector<std::string> parts;
+        size_t last = 0;
 
-                return value;
-            } catch (const std::bad_cast& ex) {
-                // it isn't an attack move
+        for (size_t i = 0; i <= s.size(); ++i) {
+            if (i == s.size() || s.at(i) == delimiter) {
+                parts.push_back(s.substr(last, i - last));
+                last = i + 1;
             }
+        }
 
-            try {
-                const auto& move = dynamic_cast<const DurakState::ThrowInMove&>(m);
+        return parts;
+    };
 
-                size_t value = 0;
+    auto card = [](const std::string& s) {
+        if (!s.empty() && s.front() == '+')
+            return Card(s.substr(1), false);
 
-                for (const DurakState::Card& c : move.cards)
-                    value ^= h(c);
+        return Card(s);
+    };
 
-                return (value << 16u) || (value >> 16u);
-            } catch (const std::bad_cast& ex) {
-                // it isn't an attack move
-            }
+    auto cards = [&split, &card](const std::string& s) {
+        std::vector<Card> cards;
 
-            return 0;
-        }
+        if (!s.empty())
+            for (const std::string& c : split(s, ','))
+                cards.push_back(card(c));
+
+        return cards;
     };
-}
 
-bool operator==(const DurakState::Move& move, const DurakState::Move& other) {
-    try {
-        auto m1 = dynamic_cast<const DurakState::AttackMove&>(move);
+    std::vector<std::string> fields = split(s, ';');
+    BasicDurakState state({}, {}, {}, {}, {}, -1, false, -1, -1, 1);
+    size_t players = state.numberOfPlayers;
 
-        try {
-            auto m2 = dynamic_cast<const DurakState::AttackMove&>(other);
+    if (fields.size() != players + 9)
+        throw std::runtime_error("Bad state description: expected " + std::to_string(players + 9) +
+                                 " fields, got " + std::to_string(fields.size()));
 
-            std::set<DurakState::Card> set1(m1.cards.begin(), m1.cards.end());
-            std::set<DurakState::Card> set2(m2.cards.begin(), m2.cards.end());
+    state.deck = cards(fields.at(0));
 
-            return set1 == set2;
-        } catch (const std::bad_cast& ex) {
-            return false;
-        }
-    } catch (const std::bad_cast& ex) {}
+    for (size_t i = 0; i < players; ++i)
+        state.hands[i] = cards(fields.at(i + 1));
 
-    try {
-        auto m1 = dynamic_cast<const DurakState::DefendMove&>(move);
+    state.attack = cards(fields.at(players + 1));
 
-        try {
-            auto m2 = dynamic_cast<const DurakState::DefendMove&>(other);
+    if (!fields.at(players + 2).empty())
+        for (const std::string& p : split(fields.at(players + 2), ',')) {
+            std::vector<std::string> pair = split(p, '/');
 
-            std::set<std::pair<DurakState::Card, DurakState::Card>> set1(m1.cards.begin(), m1.cards.end());
-            std::set<std::pair<DurakState::Card, DurakState::Card>> set2(m2.cards.begin(), m2.cards.end());
+            if (pair.size() != 2)
+                throw std::runtime_error("Bad state description: defended pair " + p);
 
-            return set1 == set2;
-        } catch (const std::bad_cast& ex) {
-            return false;
+            state.defended.emplace_back(card(pair.at(0)), card(pair.at(1)));
         }
-    } catch (const std::bad_cast& ex) {}
 
-    try {
-        auto m1 = dynamic_cast<const DurakState::ThrowInMove&>(move);
+    state.discard = cards(fields.at(players + 3));
+    state.trump = std::stoi(fields.at(players + 4));
+    state.defending = std::stoi(fields.at(players + 5));
+    state.defendingPlayer = std::stoi(fields.at(players + 6));
+    state.attackingPlayer = std::stoi(fields.at(players + 7));
+    state.playerToMove = std::stoi(fields.at(players + 8));
 
-        try {
-            auto m2 = dynamic_cast<const DurakState::ThrowInMove&>(other);
+    return state;
+}
 
-            std::set<DurakState::Card> set1(m1.cards.begin(), m1.cards.end());
-            std::set<DurakState::Card> set2(m2.cards.begin(), m2.cards.end());
+template<typename Rules>
+BasicDurakState<Rules>::BasicDurakState(std::vector<Card> deck, Hands hands,
+                                        std::vector<Card> attack, std::vector<std::pair<Card, Card>> defended,
+                                        std::vector<Card> discard, int trump, bool defending, int defendingPlayer,
+                                        int attackingPlayer, int playerToMove):
+        deck(std::move(deck)), hands(std::move(hands)), attack(std::move(attack)),
+        defended(std::move(defended)), discard(std::move(discard)), trump(trump), defending(defending),
+        defendingPlayer(defendingPlayer), attackingPlayer(attackingPlayer), playerToMove(playerToMove) {
 
-            return set1 == set2;
-        } catch (const std::bad_cast& ex) {
-            return false;
-        }
-    } catch (const std::bad_cast& ex) {}
+}
 
-    return move._null == other._null;
+namespace std {
+    template<>
+    struct hash<DurakMoveRecord> {
+        size_t operator()(const DurakMoveRecord& m) const {
+            return m.packed * 0x9e3779b97f4a7c15ull ^ m.beaten;
+        }
+    };
 }
 
-#endif //MCTS_DURAK_H
\ No newline at end of file
+using DurakState = BasicDurakState<DurakRules<>>;
+
+static_assert(checkGameState<DurakState>(), "DurakState must be a game for MCTS");
+static_assert(checkGameState<BasicDurakState<DurakRules<2, 52, 6, false>>>(),
+              "every variant of Durak must be a game for MCTS");
+
+#endif //MCTS_DURAK_H
@@ -0,0 +1,248 @@
+#ifndef MCTS_DURAKAGENT_H
+#define MCTS_DURAKAGENT_H
+
+#include <cmath>
+#include <array>
+#include <string>
+#include <vector>
+#include <random>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include "Durak.h"
+
+// Plays random rollouts like RandomAgent and gives the tree move priors from DurakState::movePriority:
+// exp(priority / temperature), so a move a rank more expensive than another gets exp(-1 / temperature)
+// times its prior. Expensive throw-ins and giving up get tiny priors and PUCT leaves them alone early
+struct DurakPriorAgent {
+    double temperature;
+
+    explicit DurakPriorAgent(double temperature = 6.0): temperature(temperature) {}
+
+    DurakState::Move getMove(DurakState& state) const { return state.randomMove(); }
+    double prior(const DurakState& state, const DurakState::Move& move) const;
+};
+
+inline double DurakPriorAgent::prior(const DurakState& state, const DurakState::Move& move) const {
+    return std::exp(state.movePriority(move) / temperature);
+}
+
+// Plays rollouts sampling the moves with probabilities softmax(weights * features). The features of a move
+// are sparse, so a move is scored by a handful of weight lookups. The weights are fitted by MCTSTrain
+// to the moves of the searches in self-play and saved in a text file of "name weight" lines.
+// The zero weights play like RandomAgent
+class DurakSoftmaxAgent {
+public:
+    // the offsets of the feature groups. A side is 0 for attacking and throwing in, 1 for defending
+    enum : size_t {
+        Kind = 0, // 1 for the kind of the move
+        Rank = Kind + 5, // per side and rank: the number of cards of the rank given away
+        Trumps = Rank + 2 * DurakState::numberOfRanks, // per side: the number of trumps given away
+        Extra = Trumps + 2, // per side: the number of cards given away beyond the first
+        Stage = Extra + 2, // per stage and kind: 1, the stages are the empty deck, at most 6 cards and more
+        Beats = Stage + 3 * 5, // per side: the number of cards given away which could beat a card of the attack
+        numberOfFeatures = Beats + 2
+    };
+
+    using Weights = std::array<float, numberOfFeatures>;
+
+    // what the features of the moves depend on besides the moves themselves, the same for all the moves
+    struct Context {
+        uint64_t hand; // of the player to move
+        uint64_t beats; // the cards which could beat a card of the attack
+        int trump;
+        int stage;
+    };
+
+    // the non-zero features of a move
+    struct Features {
+        std::array<std::pair<uint16_t, float>, 16> items;
+        size_t size = 0;
+
+        void add(size_t feature, float value) { items[size++] = {static_cast<uint16_t>(feature), value}; }
+    };
+
+    explicit DurakSoftmaxAgent(const Weights& weights = Weights{}): weights(weights), rng(5) {}
+
+    DurakState::Move getMove(DurakState& state) const;
+
+    static Context context(const DurakState& state);
+    // kind and cards as given by DurakState::MoveGenerator
+    static Features features(const Context& context, DurakState::MoveKind kind, uint64_t cards);
+    float score(const Features& features) const;
+
+    static std::string featureName(size_t feature);
+    static Weights load(const std::string& path); // throws std::runtime_error on a bad file
+    static void save(const std::string& path, const Weights& weights);
+
+    Weights weights;
+
+private:
+    mutable std::mt19937 rng;
+    mutable std::vector<float> probabilities;
+};
+
+inline DurakState::Move DurakSoftmaxAgent::getMove(DurakState& state) const {
+    // the order doesn't matter here, and the shuffled generator doesn't sort the moves by priority
+    DurakState::MoveGenerator generator = state.randomMoveGenerator();
+
+    if (generator.size() <= 1)
+        return generator.size() ? generator.move(0) : DurakState::Move::null();
+
+    Context context = this->context(state);
+    probabilities.resize(generator.size());
+
+    float max = 0;
+    for (size_t i = 0; i < generator.size(); ++i) {
+        probabilities[i] = score(features(context, generator.kind(i), generator.cards(i)));
+        max = i ? std::max(max, probabilities[i]) : probabilities[i];
+    }
+
+    float sum = 0;
+    for (float& p : probabilities)
+        sum += p = std::exp(p - max);
+
+    float r = std::uniform_real_distribution<float>(0, sum)(rng);
+    size_t chosen = 0;
+
+    while (chosen + 1 < probabilities.size() && r >= probabilities[chosen])
+        r -= probabilities[chosen++];
+
+    return generator.move(chosen);
+}
+
+inline DurakSoftmaxAgent::Context DurakSoftmaxAgent::context(const DurakState& state) {
+    Context context{};
+    context.hand = DurakState::cardsMask(state.getHands().at(state.playerToMove - 1));
+    context.trump = state.getTrump();
+
+    size_t deck = state.getDeck().size();
+    context.stage = deck == 0 ? 0 : deck <= 6 ? 1 : 2;
+
+    // card n is rank * numberOfSuits + suit, so the higher cards of a suit are its cards above n
+    auto suit = [](int s) {
+        uint64_t mask = 0;
+        for (int rank = 0; rank < DurakState::numberOfRanks; ++rank)
+            mask |= 1ull << (rank * DurakState::numberOfSuits + s);
+        return mask;
+    };
+
+    for (const DurakState::Card& card : state.getAttack()) {
+        context.beats |= suit(card.suit()) & ~((2ull << card.n) - 1);
+
+        if (card.suit() != context.trump)
+            context.beats |= suit(context.trump);
+    }
+
+    return context;
+}
+
+inline DurakSoftmaxAgent::Features DurakSoftmaxAgent::features(const Context& context, DurakState::MoveKind kind,
+                                                               uint64_t cards) {
+    Features features;
+    features.add(Kind + kind, 1);
+    features.add(Stage + context.stage * 5 + kind, 1);
+
+    // cards are only the ones given away, a defend move keeps the cards it beats in Move::beaten. A move of
+    // another determinization, as MCTSTrain passes, may give away cards this hand hasn't got, they are dropped
+    cards &= context.hand;
+
+    if (!cards)
+        return features;
+
+    int side = kind == DurakState::Defend ? 1 : 0;
+    int trumps = 0, size = 0;
+
+    for (uint64_t rest = cards; rest; rest &= rest - 1, ++size) {
+        DurakState::Card card(__builtin_ctzll(rest));
+        features.add(Rank + side * DurakState::numberOfRanks + card.rank(), 1);
+        trumps += card.suit() == context.trump;
+    }
+
+    if (trumps)
+        features.add(Trumps + side, trumps);
+    if (size > 1)
+        features.add(Extra + side, size - 1);
+    if (uint64_t beats = cards & context.beats)
+        features.add(Beats + side, __builtin_popcountll(beats));
+
+    return features;
+}
+
+inline float DurakSoftmaxAgent::score(const Features& features) const {
+    float score = 0;
+
+    for (size_t i = 0; i < features.size; ++i)
+        score += weights[features.items[i].first] * features.items[i].second;
+
+    return score;
+}
+
+inline std::string DurakSoftmaxAgent::featureName(size_t feature) {
+    static const std::string kinds[] = {"attack", "defend", "give-up", "throw-in", "pass"};
+    static const std::string sides[] = {"attack", "defend"};
+    static const std::string stages[] = {"empty", "short", "long"};
+
+    if (feature < Rank)
+        return "kind." + kinds[feature - Kind];
+    if (feature < Trumps)
+        return "rank." + sides[(feature - Rank) / DurakState::numberOfRanks] + "." +
+               DurakState::ranks[(feature - Rank) % DurakState::numberOfRanks];
+    if (feature < Extra)
+        return "trumps." + sides[feature - Trumps];
+    if (feature < Stage)
+        return "extra." + sides[feature - Extra];
+    if (feature < Beats)
+        return "stage." + stages[(feature - Stage) / 5] + "." + kinds[(feature - Stage) % 5];
+    if (feature < numberOfFeatures)
+        return "beats." + sides[feature - Beats];
+
+    throw std::runtime_error("No feature " + std::to_string(feature));
+}
+
+inline DurakSoftmaxAgent::Weights DurakSoftmaxAgent::load(const std::string& path) {
+    std::ifstream in(path);
+
+    if (!in)
+        throw std::runtime_error("Can't open weights " + path);
+
+    Weights weights{};
+    std::string line;
+
+    // empty lines and the lines starting with # are skipped, the missing features get 0
+    while (std::getline(in, line)) {
+        if (line.empty() || line.front() == '#')
+            continue;
+
+        std::istringstream fields(line);
+        std::string name;
+        float weight;
+
+        if (!(fields >> name >> weight))
+            throw std::runtime_error("Bad weights " + path + ": " + line);
+
+        size_t feature = 0;
+        while (feature < numberOfFeatures && featureName(feature) != name)
+            ++feature;
+
+        if (feature == numberOfFeatures)
+            throw std::runtime_error("Bad weights " + path + ": unknown feature " + name);
+
+        weights[feature] = weight;
+    }
+
+    return weights;
+}
+
+inline void DurakSoftmaxAgent::save(const std::string& path, const Weights& weights) {
+    std::ofstream out(path, std::ios::trunc);
+    out << "# DurakSoftmaxAgent weights" << std::endl;
+
+    for (size_t feature = 0; feature < numberOfFeatures; ++feature)
+        out << featureName(feature) << " " << weights[feature] << std::endl;
+
+    if (!out)
+        throw std::runtime_error("Can't write weights " + path);
+}
+
+#endif //MCTS_DURAKAGENT_H
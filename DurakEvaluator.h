@@ -0,0 +1,94 @@
+#ifndef MCTS_DURAKEVALUATOR_H
+#define MCTS_DURAKEVALUATOR_H
+
+#include <array>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include "Durak.h"
+
+// A leaf evaluator for MCTS::loopBatched: a linear score of every player from a few features of their
+// hand, turned into the chances of winning by a softmax over the players. The features of the whole batch
+// are extracted first into one array, then all the scores are taken in one pass over it
+class DurakLinearEvaluator {
+public:
+    enum Feature {
+        HandSize, // cards in hand / 6
+        Trumps, // trumps in hand
+        MeanCost, // the mean cost of the cards in hand, rank + 9 for trumps, / 18
+        EndgameHandSize, // cards in hand / 6 when the deck is empty, the race to get rid of the cards
+        Defending, // 1 if the player is defending
+        numberOfFeatures
+    };
+
+    using Weights = std::array<float, numberOfFeatures>;
+
+    explicit DurakLinearEvaluator(const Weights& weights = {-2.0f, 0.4f, -1.5f, -2.0f, -0.3f}): weights(weights) {}
+
+    void evaluate(const std::vector<DurakState>& leaves, std::vector<double>& values) const;
+
+    const Weights weights;
+
+private:
+    mutable std::vector<float> features; // numberOfFeatures per player per leaf
+    mutable std::vector<float> scores;
+
+    static void extract(const DurakState& state, int player, float* features);
+};
+
+inline void DurakLinearEvaluator::evaluate(const std::vector<DurakState>& leaves, std::vector<double>& values) const {
+    size_t rows = 0;
+    for (const DurakState& leaf : leaves)
+        rows += leaf.numberOfPlayers;
+
+    features.resize(rows * numberOfFeatures);
+    scores.assign(rows, 0);
+
+    size_t row = 0;
+    for (const DurakState& leaf : leaves)
+        for (int player = 1; player <= leaf.numberOfPlayers; ++player)
+            extract(leaf, player, features.data() + row++ * numberOfFeatures);
+
+    // feature by feature over all the rows, which the compiler vectorizes
+    for (size_t f = 0; f < numberOfFeatures; ++f)
+        for (size_t r = 0; r < rows; ++r)
+            scores[r] += weights[f] * features[r * numberOfFeatures + f];
+
+    values.resize(rows);
+    row = 0;
+
+    for (const DurakState& leaf : leaves) {
+        const float* score = scores.data() + row;
+        float max = *std::max_element(score, score + leaf.numberOfPlayers);
+        double sum = 0;
+
+        for (int p = 0; p < leaf.numberOfPlayers; ++p)
+            sum += values[row + p] = std::exp(score[p] - max);
+
+        for (int p = 0; p < leaf.numberOfPlayers; ++p)
+            values[row + p] /= sum;
+
+        row += leaf.numberOfPlayers;
+    }
+}
+
+inline void DurakLinearEvaluator::extract(const DurakState& state, int player, float* features) {
+    const std::vector<DurakState::Card>& hand = state.getHands().at(player - 1);
+    int trumps = 0, cost = 0;
+
+    for (const DurakState::Card& card : hand) {
+        bool trump = card.suit() == state.getTrump();
+        trumps += trump;
+        cost += card.rank() + (trump ? DurakState::numberOfRanks : 0);
+    }
+
+    float size = hand.size() / static_cast<float>(DurakState::handSize);
+
+    features[HandSize] = size;
+    features[Trumps] = trumps;
+    features[MeanCost] = hand.empty() ? 0 : cost / (2.0f * DurakState::numberOfRanks * hand.size());
+    features[EndgameHandSize] = state.getDeck().empty() ? size : 0;
+    features[Defending] = state.getDefendingPlayer() == player;
+}
+
+#endif //MCTS_DURAKEVALUATOR_H
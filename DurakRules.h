@@ -0,0 +1,28 @@
+#ifndef MCTS_DURAKRULES_H
+#define MCTS_DURAKRULES_H
+
+// The rules of a variant of Durak for BasicDurakState, all of them compile-time constants so that the state
+// keeps the players in fixed-size arrays and the loops over them have constant bounds:
+//   Players   the number of players, only 2 for now: the sizes follow it, but the play doesn't. The turns pass
+//             between the attacker and the defender, nobody else throws in and the first player out wins
+//   Cards     the size of the deck, the top Cards / 4 ranks of every suit: 36 is sixes to aces, 52 twos to aces
+//   HandSize  the number of cards the players are dealt up to
+//   Transfer  whether the defender may transfer the attack to the next player by adding a card of its rank
+template<int Players = 2, int Cards = 36, int HandSize = 6, bool Transfer = true>
+struct DurakRules {
+    static constexpr int numberOfPlayers = Players;
+    static constexpr int numberOfCards = Cards;
+    static constexpr int numberOfSuits = 4;
+    static constexpr int numberOfRanks = Cards / numberOfSuits;
+    static constexpr int handSize = HandSize;
+    static constexpr bool transfer = Transfer;
+
+    static_assert(Players == 2, "the play of Durak is for two players, see Players above");
+    static_assert(Cards % numberOfSuits == 0 && numberOfRanks >= 2 && numberOfRanks <= 13,
+                  "the deck is 2 to 13 ranks of 4 suits");
+    static_assert(Players * HandSize <= Cards, "there aren't enough cards to deal");
+    // a move packs its cards in the low 60 bits and a defend move the beaten cards in 6 bits each
+    static_assert(HandSize >= 1 && HandSize <= 10, "a hand is 1 to 10 cards");
+};
+
+#endif //MCTS_DURAKRULES_H
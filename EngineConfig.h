@@ -0,0 +1,81 @@
+#ifndef MCTS_ENGINECONFIG_H
+#define MCTS_ENGINECONFIG_H
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+// The search settings of the engine in a text file of "name value" lines, written by MCTSTune and
+// loaded by MCTS --config. The settings missing in the file keep their defaults
+struct EngineConfig {
+    double exploration = 0.7;
+    double widening = 0; // off, see MCTS::widening
+    double wideningExponent = 0.5;
+    double rave = 0;
+
+    // the names of the settings in the file
+    static const std::vector<std::pair<std::string, double EngineConfig::*>>& fields();
+
+    static EngineConfig load(const std::string& path); // throws std::runtime_error on a bad file
+    void save(const std::string& path) const;
+};
+
+inline const std::vector<std::pair<std::string, double EngineConfig::*>>& EngineConfig::fields() {
+    static const std::vector<std::pair<std::string, double EngineConfig::*>> fields = {
+            {"exploration", &EngineConfig::exploration},
+            {"widening", &EngineConfig::widening},
+            {"widening-exponent", &EngineConfig::wideningExponent},
+            {"rave", &EngineConfig::rave},
+    };
+
+    return fields;
+}
+
+inline EngineConfig EngineConfig::load(const std::string& path) {
+    std::ifstream in(path);
+
+    if (!in)
+        throw std::runtime_error("Can't open config " + path);
+
+    EngineConfig config;
+    std::string line;
+
+    while (std::getline(in, line)) {
+        if (line.empty() || line.front() == '#')
+            continue;
+
+        std::istringstream fields(line);
+        std::string name;
+        double value;
+
+        if (!(fields >> name >> value))
+            throw std::runtime_error("Bad config " + path + ": " + line);
+
+        auto field = std::find_if(EngineConfig::fields().begin(), EngineConfig::fields().end(),
+                                  [&name](const auto& field) { return field.first == name; });
+
+        if (field == EngineConfig::fields().end())
+            throw std::runtime_error("Bad config " + path + ": unknown setting " + name);
+
+        config.*(field->second) = value;
+    }
+
+    return config;
+}
+
+inline void EngineConfig::save(const std::string& path) const {
+    std::ofstream out(path, std::ios::trunc);
+    out << "# MCTS engine config" << std::endl;
+
+    for (const auto& [name, field] : fields())
+        out << name << " " << this->*field << std::endl;
+
+    if (!out)
+        throw std::runtime_error("Can't write config " + path);
+}
+
+#endif //MCTS_ENGINECONFIG_H
@@ -0,0 +1,168 @@
+#ifndef MCTS_GAMERECORD_H
+#define MCTS_GAMERECORD_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <stdexcept>
+#include "Durak.h"
+#include "MappedFile.h"
+
+// Binary records of played games. A file is a header followed by records appended one after another:
+//   RecordHeader, the initial state (DurakState::write) padded to 8 bytes, MoveStats of every move.
+// Records are only appended, a record cut by a crash at the end of the file is ignored by the reader
+struct GameRecord {
+    struct MoveStats {
+        DurakState::MoveRecord move;
+        uint32_t visits = 0; // of the move in the search which has chosen it, 0 if there was no search
+        uint32_t total = 0; // of the root of that search
+        float value = 0; // wins / visits of the move for the player making it
+        int32_t player = 0; // who made the move
+    };
+
+    DurakState initial;
+    std::vector<MoveStats> moves;
+    int32_t winner = 0; // 0 if the game isn't finished
+
+    explicit GameRecord(const DurakState& initial = DurakState()): initial(initial) {}
+
+    DurakState replay(size_t plies) const; // the state after the first plies moves
+};
+
+// Appends records to a file, creating it if needed
+class GameRecordWriter {
+public:
+    explicit GameRecordWriter(const std::string& path);
+
+    void write(const GameRecord& record); // writes the whole record and flushes it
+
+private:
+    std::ofstream out;
+};
+
+// Maps a file of records and indexes them on opening, the records are read in place without copying
+class GameRecordReader {
+public:
+    // a record inside the mapped file, valid while the reader is alive
+    struct View {
+        const char* state; // the initial state in the DurakState::write format
+        size_t stateBytes;
+        const GameRecord::MoveStats* moves;
+        size_t count; // of moves
+        int32_t winner;
+
+        DurakState initial() const { return DurakState::read(state, stateBytes); }
+        GameRecord record() const; // a copy of the record
+    };
+
+    explicit GameRecordReader(const std::string& path);
+
+    size_t size() const { return index.size(); }
+    View operator[](size_t i) const;
+
+private:
+    MappedFile file;
+    std::vector<size_t> index; // offsets of the records
+};
+
+namespace GameRecordFormat {
+    const char magic[8] = {'M', 'C', 'T', 'S', 'G', 'A', 'M', 'E'};
+
+    struct RecordHeader {
+        uint32_t bytes; // of the whole record including the header
+        uint32_t moves;
+        uint32_t stateBytes; // without the padding
+        int32_t winner;
+    };
+
+    inline size_t padded(size_t bytes) {
+        return (bytes + 7) / 8 * 8;
+    }
+}
+
+inline DurakState GameRecord::replay(size_t plies) const {
+    DurakState state = initial;
+
+    for (size_t i = 0; i < plies && i < moves.size(); ++i)
+        state.makeMove(DurakState::restoreMove(moves.at(i).move));
+
+    return state;
+}
+
+inline GameRecordWriter::GameRecordWriter(const std::string& path): out(path, std::ios::binary | std::ios::app) {
+    if (!out)
+        throw std::runtime_error("Can't open game records " + path);
+
+    if (out.tellp() == 0)
+        out.write(GameRecordFormat::magic, sizeof(GameRecordFormat::magic));
+}
+
+inline void GameRecordWriter::write(const GameRecord& record) {
+    std::string state;
+    record.initial.write(state);
+
+    GameRecordFormat::RecordHeader header{};
+    header.bytes = sizeof(header) + GameRecordFormat::padded(state.size()) +
+                   record.moves.size() * sizeof(GameRecord::MoveStats);
+    header.moves = record.moves.size();
+    header.stateBytes = state.size();
+    header.winner = record.winner;
+
+    state.resize(GameRecordFormat::padded(state.size()), '\0');
+
+    // one buffer, so that a record is never interleaved with a partial write
+    std::string buffer(reinterpret_cast<const char*>(&header), sizeof(header));
+    buffer += state;
+    buffer.append(reinterpret_cast<const char*>(record.moves.data()),
+                  record.moves.size() * sizeof(GameRecord::MoveStats));
+
+    out.write(buffer.data(), buffer.size());
+    out.flush();
+
+    if (!out)
+        throw std::runtime_error("Can't write a game record");
+}
+
+inline GameRecordReader::GameRecordReader(const std::string& path): file(path) {
+    if (file.size() < sizeof(GameRecordFormat::magic) ||
+        std::memcmp(file.data(), GameRecordFormat::magic, sizeof(GameRecordFormat::magic)) != 0)
+        throw std::runtime_error("Bad game records " + path + ": wrong magic");
+
+    size_t offset = sizeof(GameRecordFormat::magic);
+
+    while (offset + sizeof(GameRecordFormat::RecordHeader) <= file.size()) {
+        const auto* header = reinterpret_cast<const GameRecordFormat::RecordHeader*>(file.data() + offset);
+
+        if (header->bytes != sizeof(*header) + GameRecordFormat::padded(header->stateBytes) +
+                             header->moves * sizeof(GameRecord::MoveStats))
+            throw std::runtime_error("Bad game records " + path + ": broken record " + std::to_string(index.size()));
+
+        if (offset + header->bytes > file.size())
+            break;
+
+        index.push_back(offset);
+        offset += header->bytes;
+    }
+}
+
+inline GameRecordReader::View GameRecordReader::operator[](size_t i) const {
+    const char* data = file.data() + index.at(i);
+    const auto* header = reinterpret_cast<const GameRecordFormat::RecordHeader*>(data);
+    const char* state = data + sizeof(*header);
+
+    return {state, header->stateBytes,
+            reinterpret_cast<const GameRecord::MoveStats*>(state + GameRecordFormat::padded(header->stateBytes)),
+            header->moves, header->winner};
+}
+
+inline GameRecord GameRecordReader::View::record() const {
+    GameRecord record(initial());
+    record.moves.assign(moves, moves + count);
+    record.winner = winner;
+
+    return record;
+}
+
+#endif //MCTS_GAMERECORD_H
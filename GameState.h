@@ -0,0 +1,120 @@
+#ifndef MCTS_GAMESTATE_H
+#define MCTS_GAMESTATE_H
+
+#include <string>
+#include <random>
+#include <functional>
+#include <type_traits>
+#include <utility>
+
+// The interface of a game for MCTS. Moves are values, the tree keeps them in a table and copies them around
+// freely, so they must be trivially copyable and hold no pointers:
+//   State::Move            Move(), null(), isNull(), ==, explicit conversion to std::string
+//   State::MoveRecord      a lossless trivially copyable form of a move for snapshots and move tables,
+//                          hashed by std::hash, with static recordMove(Move) and restoreMove(MoveRecord)
+//   State::MoveGenerator   bool next(Move&) and size(), the number of moves it yields in all, which doesn't
+//                          change as next takes them
+//   State::InformationSet  what the observer knows: observer, playerToMove, State sample(std::mt19937&),
+//                          sample(State&, std::mt19937&) reusing the state, makeMove(Move) and isLegal(Move),
+//                          whether the player to move may have the move, exact when they are the observer
+//   State                  numberOfPlayers, playerToMove, informationSet(), informationSet(int observer),
+//                          isTerminal(), getResult(int player) in [0, 1], isLegal(Move), moveGenerator(),
+//                          makeMoveUnchecked(Move) and randomMove()
+// The opening book, the time management and the snapshots need more of InformationSet: canonicalKey(),
+// canonicalMove(Move), fromCanonicalMove(uint64_t), expectedMoves(), criticality() and write/read
+namespace game {
+    template<typename State, typename = void>
+    struct HasMove : std::false_type {};
+
+    template<typename State>
+    struct HasMove<State, std::void_t<
+            decltype(typename State::Move()),
+            decltype(State::Move::null()),
+            decltype(bool(std::declval<const typename State::Move&>().isNull())),
+            decltype(bool(std::declval<const typename State::Move&>() == std::declval<const typename State::Move&>())),
+            decltype(static_cast<std::string>(std::declval<const typename State::Move&>()))>> : std::true_type {};
+
+    template<typename State, typename = void>
+    struct HasMoveRecord : std::false_type {};
+
+    template<typename State>
+    struct HasMoveRecord<State, std::void_t<
+            decltype(std::hash<typename State::MoveRecord>()(std::declval<const typename State::MoveRecord&>())),
+            decltype(bool(std::declval<const typename State::MoveRecord&>() ==
+                          std::declval<const typename State::MoveRecord&>())),
+            std::enable_if_t<std::is_same<decltype(State::recordMove(std::declval<const typename State::Move&>())),
+                                          typename State::MoveRecord>::value>,
+            std::enable_if_t<std::is_same<decltype(State::restoreMove(
+                    std::declval<const typename State::MoveRecord&>())), typename State::Move>::value>>>
+            : std::true_type {};
+
+    template<typename State, typename = void>
+    struct HasMoveGenerator : std::false_type {};
+
+    template<typename State>
+    struct HasMoveGenerator<State, std::void_t<
+            decltype(std::declval<const State&>().moveGenerator().size()),
+            decltype(bool(std::declval<typename State::MoveGenerator&>().next(
+                    std::declval<typename State::Move&>())))>> : std::true_type {};
+
+    template<typename State, typename = void>
+    struct HasInformationSet : std::false_type {};
+
+    template<typename State>
+    struct HasInformationSet<State, std::void_t<
+            decltype(int(std::declval<const typename State::InformationSet&>().observer)),
+            decltype(int(std::declval<const typename State::InformationSet&>().playerToMove)),
+            std::enable_if_t<std::is_same<decltype(std::declval<const typename State::InformationSet&>().sample(
+                    std::declval<std::mt19937&>())), State>::value>,
+            decltype(std::declval<const typename State::InformationSet&>().sample(
+                    std::declval<State&>(), std::declval<std::mt19937&>())),
+            decltype(std::declval<typename State::InformationSet&>().makeMove(
+                    std::declval<const typename State::Move&>())),
+            decltype(bool(std::declval<const typename State::InformationSet&>().isLegal(
+                    std::declval<const typename State::Move&>()))),
+            std::enable_if_t<std::is_same<decltype(std::declval<const State&>().informationSet()),
+                                          typename State::InformationSet>::value>,
+            std::enable_if_t<std::is_same<decltype(std::declval<const State&>().informationSet(1)),
+                                          typename State::InformationSet>::value>>> : std::true_type {};
+
+    template<typename State, typename = void>
+    struct HasRules : std::false_type {};
+
+    template<typename State>
+    struct HasRules<State, std::void_t<
+            decltype(int(std::declval<const State&>().numberOfPlayers)),
+            decltype(int(std::declval<const State&>().playerToMove)),
+            decltype(bool(std::declval<const State&>().isTerminal())),
+            decltype(double(std::declval<const State&>().getResult(1))),
+            decltype(bool(std::declval<const State&>().isLegal(std::declval<const typename State::Move&>()))),
+            decltype(std::declval<State&>().makeMoveUnchecked(std::declval<const typename State::Move&>())),
+            std::enable_if_t<std::is_same<decltype(std::declval<State&>().randomMove()),
+                                          typename State::Move>::value>>> : std::true_type {};
+}
+
+// true if State satisfies the interface above, with a message about the first part it misses otherwise
+template<typename State>
+constexpr bool checkGameState() {
+    static_assert(game::HasMove<State>::value,
+                  "State::Move needs Move(), null(), isNull(), == and an explicit conversion to std::string");
+    static_assert(std::is_trivially_copyable<typename State::Move>::value,
+                  "State::Move must be a trivially copyable value");
+    static_assert(game::HasMoveRecord<State>::value,
+                  "State needs MoveRecord with std::hash and ==, recordMove(Move) and restoreMove(MoveRecord)");
+    static_assert(std::is_trivially_copyable<typename State::MoveRecord>::value,
+                  "State::MoveRecord must be trivially copyable, the snapshots write it as it is");
+    // size() is the total number of moves of the generator, not the number left, see above
+    static_assert(game::HasMoveGenerator<State>::value, "State needs moveGenerator() with size() and next(Move&)");
+    static_assert(game::HasInformationSet<State>::value,
+                  "State needs informationSet() and informationSet(int) returning an InformationSet with "
+                  "observer, playerToMove, sample(rng), sample(State&, rng), makeMove(Move) and isLegal(Move)");
+    static_assert(game::HasRules<State>::value,
+                  "State needs numberOfPlayers, playerToMove, isTerminal(), getResult(int), isLegal(Move), "
+                  "makeMoveUnchecked(Move) and randomMove() returning a Move");
+
+    return game::HasMove<State>::value && game::HasMoveRecord<State>::value &&
+           game::HasMoveGenerator<State>::value && game::HasInformationSet<State>::value &&
+           game::HasRules<State>::value;
+}
+
+#endif //MCTS_GAMESTATE_H
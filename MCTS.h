@@ -5,307 +5,1311 @@
 #include <vector>
 #include <algorithm>
 #include <unordered_set>
+#include <unordered_map>
+#include <cstdint>
 #include <cmath>
+#include <random>
+#include <iostream>
+#include <functional>
+#include <future>
+#include <fstream>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+#include "StopToken.h"
+#include "OpeningBook.h"
+#include "MappedFile.h"
+#include "TimeManager.h"
+#include "Policy.h"
+#include "GameState.h"
 
 template<typename State>
 struct RandomAgent {
-    typename State::MovePtr getMove(State& s) const;
+    typename State::Move getMove(State& s) const;
 };
 
-template<typename T>
-struct SharedHash {
-private:
-    std::hash<T> h;
-public:
-    size_t operator()(const std::shared_ptr<T>& ptr) const {
-        return h(*ptr);
-    }
-};
+// An agent may also give the tree move priors with
+//   double prior(const State& state, const typename State::Move& move) const
+// a non-negative weight of a legal move in state, the tree normalizes the weights over the legal children.
+// The priors are taken only if the policy reads them, see Policy::usesPriors
+template<typename Agent, typename State, typename = void>
+struct HasPriors : std::false_type {};
 
-template <typename T>
-struct SharedEqual {
-    bool operator()(const std::shared_ptr<T>& ptr1, const std::shared_ptr<T>& ptr2) const {
-        return (*ptr1) == (*ptr2);
-    }
-};
+template<typename Agent, typename State>
+struct HasPriors<Agent, State, std::void_t<decltype(std::declval<const Agent&>().prior(
+        std::declval<const State&>(), std::declval<const typename State::Move&>()))>> : std::true_type {};
 
-template<typename State, typename Agent = RandomAgent<State>>
+// State is a game as described in GameState.h, Policy is the selection rule, see Policy.h
+template<typename State, typename Agent = RandomAgent<State>, typename Policy = UCB1>
 class MCTS {
+    static_assert(checkGameState<State>(), "State isn't a game for MCTS, see GameState.h");
 
-    using MovePtr = typename State::MovePtr;
     using Move = typename State::Move;
+    using InformationSet = typename State::InformationSet;
+    using MoveRecord = typename State::MoveRecord;
+
+    static constexpr uint32_t None = UINT32_MAX; // no node or no move
+
+    // All the nodes live in one vector and refer to each other by index. The moves are kept once each in
+    // a side table, the children of a node are a list linked through nextSibling
+    struct Node {
+        uint32_t move; // index in moves, None for the root
+        uint32_t firstChild = None;
+        uint32_t nextSibling = None;
+        uint32_t visits = 0;
+        uint32_t avails = 1;
+        float wins = 0;
+        int32_t justMoved;
+
+        Node(uint32_t move, int justMoved): move(move), justMoved(justMoved) {}
+    };
 
-    struct Node: public std::enable_shared_from_this<Node> {
-        using Ptr = std::shared_ptr<Node>;
-        using wPtr = std::weak_ptr<Node>;
-
-        MovePtr move;
-        wPtr parent;
-        int just_moved;
-
-        std::vector<Ptr> children;
-        double wins;
-        size_t visits;
-        size_t avails;
+    static_assert(sizeof(Node) <= 32, "a node should fit in half a cache line");
 
-        Node(MovePtr m, Ptr parent, int p);
+    // all-moves-as-first statistics of a node: the results of the simulations in which its move was made later
+    // by the same player after its parent. Kept in a side array, so they take memory only with RAVE on
+    struct Amaf {
+        uint32_t visits = 0;
+        float wins = 0;
+    };
 
-        void update(const State& state);
-        std::vector<MovePtr> getUntriedMoves(const std::vector<MovePtr>& legalMoves) const;
-        Ptr UCBSelectChild(const std::vector<MovePtr>& legalMoves, double exploration = 0.7) const;
-        double ucb(double exploration = 0.7) const;
-        Ptr addChild(MovePtr move, int just_moved);
+    using Stats = typename Policy::Stats;
+    static constexpr bool hasStats = !std::is_empty<Stats>::value;
+    // with priors a node gets all its moves as children when it's first reached, and the policy picks among them
+    static constexpr bool hasPriors = HasPriors<Agent, State>::value && Policy::usesPriors;
+
+    // the snapshot file is the header, the nodes with the root first, MoveRecord of every move, the Stats
+    // and the prior of every node and InformationSet::write of root_info. Every block starts aligned for its
+    // type, so that the mapped file can be read in place
+    struct SnapshotHeader {
+        char magic[8];
+        uint32_t nodeSize; // sizeof(Node) of the writer
+        uint32_t moves;
+        uint64_t nodes;
+        uint64_t infoBytes;
+        uint32_t statsSize; // sizeof(Stats) of the writer, 0 if its policy keeps nothing
+        uint32_t priorSize; // sizeof(float) if the writer kept priors, 0 if not
     };
 
-    using NodePtr = std::shared_ptr<Node>;
+    // the offsets of the blocks in the snapshot file
+    struct SnapshotLayout {
+        uint64_t records;
+        uint64_t stats;
+        uint64_t priors;
+        uint64_t info;
+        uint64_t size; // of the whole file
+    };
 
 private:
-    std::shared_ptr<Node> root;
-    State root_state;
+    mutable std::vector<Node> nodes;
+    mutable std::vector<Move> moves;
+    mutable std::unordered_map<MoveRecord, uint32_t> moveIds; // the index of every move in moves
+    mutable std::vector<Amaf> amaf; // parallel to nodes, empty until RAVE is used
+    mutable std::vector<Stats> stats; // of the policy, parallel to nodes, empty if the policy keeps nothing
+    mutable Stats noStats; // what the arms point to when the policy keeps nothing
+    mutable std::vector<float> priors; // the agent's prior of every node's move, empty without hasPriors
+    uint32_t root = 0;
+
+    InformationSet root_info; // the search never sees the real hidden cards, only samples them
     Agent agent;
+    mutable std::mt19937 rng;
+
+    // scratch space of the iterations, kept to avoid allocations
+    mutable std::vector<uint32_t> path;
+    mutable std::vector<uint32_t> legal;
+    mutable std::vector<uint32_t> tried; // by move id, equal to triedMark for the moves of the node expanded
+    mutable uint32_t triedMark = 0;
+    mutable std::vector<Arm<Stats>> arms;
+    mutable std::vector<std::pair<uint32_t, int>> played; // the moves of the simulation with their players, RAVE only
+    mutable std::unordered_map<uint64_t, uint32_t> lastPlayed; // (move, player) to its last index in played
+
+    mutable size_t saved = 0; // iterations saved by the early stop in the last getMove
 
-    void loop(NodePtr node, const State& initial, size_t iters = 10'000) const;
-    State iterate(NodePtr node, const State& initial) const;
+    void loop(uint32_t node, const InformationSet& initial, size_t iters = 10'000) const;
+    // state is the working determinization, it is resampled from initial at the start of the iteration
+    void iterate(uint32_t node, const InformationSet& initial, State& state) const;
 
-    State determinize(const State& state) const;
+    void determinize(const InformationSet& info, State& state) const;
 
-    NodePtr select(NodePtr node, State& state) const;
-    NodePtr expand(NodePtr node, State& state, const std::vector<MovePtr>& untried) const;
+    uint32_t select(uint32_t node, State& state) const; // fills path with the selected nodes
+    uint32_t expand(uint32_t node, State& state, const Move& move) const;
+    bool canWiden(uint32_t node, size_t legalChildren) const; // progressive widening
+    // adds children with their priors for the untried moves of state, returns false if there were none
+    bool expandAll(uint32_t node, const State& state) const;
+    void widenByPriors(uint32_t node) const; // progressive widening of legal by priors
 
     void rollout(State& state, const Agent& agent) const;
+    // result(player) is the result of the simulation for player. visited is true if the visits of path
+    // were already counted by the virtual loss of a batched descent
+    template<typename Result>
+    void backpropagate(const Result& result, bool visited) const;
+    template<typename Result>
+    void updateAmaf(const Result& result) const; // credits the siblings of path with the moves played
+
+    void getLegalChildren(uint32_t node, const State& state) const; // fills legal
+    // pulls the first generated move without a child
+    bool getUntriedMove(uint32_t node, const State& state, Move& move) const;
+    void markTried(uint32_t node) const; // marks the moves of the children of node in tried
+    bool isTried(const Move& move) const; // whether markTried marked the move
+    uint32_t selectChild() const; // one of legal, chosen by the policy
+    uint32_t addChild(uint32_t node, const Move& move, int justMoved) const;
+    void growSideArrays() const; // makes the side arrays in use as long as nodes
+    uint32_t moveId(const Move& move) const; // adds the move to the table if it isn't there
+
+    // the children of the root the player to move may have by root_info, the same on every call. A node
+    // reached by makeMove may have children made in determinizations where the player held other cards,
+    // e.g. before they were dealt
+    std::vector<uint32_t> rootChildren() const;
+    // the legal move of the observer if they are to move and have just one, the null move otherwise
+    Move singleMove() const;
 
 public:
+    // a snapshot of the root, reported while a search runs
+    struct Progress {
+        struct Child {
+            Move move;
+            size_t visits;
+            double wins; // for the player making the move
+        };
+
+        size_t iterations = 0; // made by the search so far
+        size_t visits = 0; // of the root
+        Move best; // the most visited move, null if the root has no children yet
+        std::vector<Child> children; // every move of the root
+    };
+
+    using ProgressCallback = std::function<void(const Progress&)>;
+
+    // the result of getMoveAsync, stop makes the search return its current best move as soon as possible
+    struct AsyncMove {
+        std::future<Move> move;
+        StopSource stop;
+    };
+
+    // what the tree takes, there is one move in the table per distinct move
+    struct Memory {
+        size_t nodes = 0; // allocated, including the ones cut off by makeMove until compact
+        size_t reachable = 0; // under the root
+        size_t nodeBytes = 0;
+        size_t moveBytes = 0; // of the move table and its index
+
+        size_t bytes() const { return nodeBytes + moveBytes; }
+        double bytesPerNode() const { return reachable ? static_cast<double>(bytes()) / reachable : 0; }
+    };
+
     const double exploration;
+    Policy policy; // made from exploration
+
+    // progressive widening: a node with n visits may have at most max(1, widening * n^wideningExponent)
+    // children legal in the current determinization, with priors the ones of the highest priors.
+    // Non-positive widening, the default, disables it
+    const double widening;
+    const double wideningExponent;
+
+    enum class EarlyStop {
+        Never,
+        VisitGap, // when the most visited root move can't be overtaken in the remaining iterations
+        Confidence, // also when its lower confidence bound is above the upper bounds of the other root moves
+    };
 
-    explicit MCTS(double exploration = 0.7, const State& state = State(),
-                  const Agent& agent = RandomAgent<State>());
+    EarlyStop earlyStop = EarlyStop::VisitGap;
+    double earlyStopDelta = 0.01; // the chance of a wrong stop allowed by the Hoeffding bounds of Confidence
+
+    // RAVE: the selection blends the value of a child with its AMAF value, the weight of the latter is
+    // sqrt(rave / (3 * visits + rave)), so rave is the number of visits at which both weigh about the same.
+    // 0 disables it. The AMAF and the policy statistics aren't saved in snapshots
+    double rave = 0;
 
-    MovePtr getMove(size_t iters = 10'000) const; // getMove in one thread for the best move
+    std::ostream* output = &std::cout; // where getMove prints the root statistics, nullptr to keep silent
+    std::shared_ptr<const OpeningBook> book; // getMove plays the book moves without searching
+
+    // the search is rooted at the information set of the player to move in state
+    explicit MCTS(double exploration = 0.7, const State& state = State(),
+                  const Agent& agent = Agent(), double widening = 0, double wideningExponent = 0.5);
+    MCTS(double exploration, const InformationSet& info,
+         const Agent& agent = Agent(), double widening = 0, double wideningExponent = 0.5);
+
+    Move getMove(size_t iters = 10'000) const; // getMove in one thread for the best move
+    Move bestMove() const; // the most visited move of the root, doesn't search
+    Move bookMove() const; // the move of root_info in the book, the null move if there is none
+    Progress progress() const; // the root statistics, doesn't search
+    Memory memory() const;
+
+    // whether the move getMove would return can't change in the remaining iterations, see earlyStop
+    bool isDecided(size_t remaining) const;
+    size_t savedIterations() const { return saved; } // by the early stop in the last getMove
+
+    // searches until iters are made or stop is requested, calling progress every `every` iterations
+    Move getMove(size_t iters, const StopToken& stop, const ProgressCallback& progress = {},
+                    size_t every = 1'000) const;
+    // searches for the time the clock allots to the position and charges the clock. A single legal move is
+    // returned at once, the search goes on past the target while the best move keeps changing or is close
+    // to the second one
+    Move getMove(TimeManager& clock) const;
+    // the same in a new thread, the MCTS mustn't be used until the future is ready
+    AsyncMove getMoveAsync(size_t iters = 10'000, ProgressCallback progress = {}, size_t every = 1'000) const;
+
+    // An evaluator scores leaves in batches instead of the rollouts:
+    //   void evaluate(const std::vector<State>& leaves, std::vector<double>& values) const
+    // values gets the expected result of every player for every leaf, values[i * numberOfPlayers + player - 1].
+    // A batch of descents is made before the evaluation, each adding a virtual loss to its path, so that
+    // the next ones spread over other moves. Terminal leaves are scored by their own results
+    template<typename Evaluator>
+    Move getMoveBatched(size_t iters, const Evaluator& evaluator, size_t batch = 32) const;
+    template<typename Evaluator>
+    void loopBatched(size_t iters, const Evaluator& evaluator, size_t batch = 32) const;
 
     void loop(size_t iters = 10'000) const; // makes one loop of iters iterations to increase the tree
-    State iterate() const; // makes one iteration to increase the tree
+    void iterate() const; // makes one iteration to increase the tree
 
-    void makeMove(const MovePtr& move); // makes move, changing root and root_state, removing redundant Nodes
+    // makes move, moving the root to its child and replacing root_info with what the observer knows after
+    // the move, e.g. the cards they've got. The nodes cut off stay allocated until compact
+    void makeMove(const Move& move, const InformationSet& observed);
+
+    enum class Layout {
+        BreadthFirst, // the levels of the tree one after another
+        HotPathFirst, // depth-first, the most visited child first, so the principal variation is contiguous
+    };
+
+    // moves the tree under the root to a new block in the layout order, dropping the nodes and moves cut off
+    // by makeMove. Call it between moves, it takes time linear in the tree
+    void compact(Layout layout = Layout::BreadthFirst);
+
+    // saves the tree and root_info in a binary file, the settings of the search aren't saved
+    void snapshot(const std::string& path) const;
+    // replaces the tree and root_info with a snapshot, the file is mapped and the nodes are copied at once
+    void restore(const std::string& path);
+    // the same, but throws std::runtime_error and keeps the tree unless the snapshot's root_info is expected,
+    // so that the tree can't be restored under a different position
+    void restore(const std::string& path, const InformationSet& expected);
+
+private:
+    void restore(const std::string& path, const InformationSet* expected);
+    static SnapshotLayout snapshotLayout(const SnapshotHeader& header);
+    // the tree under root in the layout order with the root first and the moves renumbered,
+    // origin gets the old index of every new node
+    void gather(Layout layout, std::vector<Node>& newNodes, std::vector<Move>& newMoves,
+                std::vector<uint32_t>& origin) const;
+    void indexMoves() const; // rebuilds moveIds from moves
 };
 
-template<typename State, typename Agent>
-MCTS<State, Agent>::MCTS(double exploration, const State& state, const Agent& agent):
-        root(std::make_shared<Node>(State::Move::null(), nullptr, -1)),
-        root_state(state), exploration(exploration), agent(agent) {
+template<typename State, typename Agent, typename Policy>
+MCTS<State, Agent, Policy>::MCTS(double exploration, const State& state, const Agent& agent,
+                         double widening, double wideningExponent):
+        MCTS(exploration, state.informationSet(), agent, widening, wideningExponent) {
+
+}
+
+template<typename State, typename Agent, typename Policy>
+MCTS<State, Agent, Policy>::MCTS(double exploration, const InformationSet& info, const Agent& agent,
+                         double widening, double wideningExponent):
+        nodes{Node(None, -1)}, root_info(info), agent(agent), rng(5), exploration(exploration),
+        policy(exploration), widening(widening), wideningExponent(wideningExponent) {
+
+}
 
+template<typename State, typename Agent, typename Policy>
+typename State::Move MCTS<State, Agent, Policy>::getMove(size_t iters) const {
+    return getMove(iters, StopToken());
 }
 
-template<typename State, typename Agent>
-typename State::MovePtr MCTS<State, Agent>::getMove(size_t iters) const {
-    loop(iters);
+template<typename State, typename Agent, typename Policy>
+typename State::Move MCTS<State, Agent, Policy>::bestMove() const {
+    const Node& r = nodes.at(root);
 
-    if (root->children.empty())
+    if (r.firstChild == None)
         return State::Move::null();
 
-    std::cout << root->wins << "/" << root->visits << std::endl;
-    for (auto it = root->children.begin(); it != root->children.end(); ++it) {
-        std::cout << (*it)->wins << "/" << (*it)->visits << " (" << static_cast<std::string>(*((*it)->move)) << "); ";
+    if (output) {
+        *output << r.wins << "/" << r.visits << std::endl;
+        for (uint32_t n = r.firstChild; n != None; n = nodes[n].nextSibling) {
+            *output << nodes[n].wins << "/" << nodes[n].visits << " ("
+                    << static_cast<std::string>(moves[nodes[n].move]) << "); ";
+        }
+        *output << std::endl;
     }
-    std::cout << std::endl;
 
-    auto best = std::max_element(begin(root->children),
-                                 end(root->children),
-                                 [](const auto& a, const auto& b) {
-                                     return a->visits < b->visits;
-                                 });
+    std::vector<uint32_t> children = rootChildren();
+
+    if (children.empty())
+        return State::Move::null();
+
+    uint32_t best = children.front();
+
+    for (uint32_t n : children)
+        if (nodes[n].visits > nodes[best].visits)
+            best = n;
+
+    return moves[nodes[best].move];
+}
+
+template<typename State, typename Agent, typename Policy>
+std::vector<uint32_t> MCTS<State, Agent, Policy>::rootChildren() const {
+    std::vector<uint32_t> children;
+
+    for (uint32_t n = nodes.at(root).firstChild; n != None; n = nodes[n].nextSibling)
+        if (root_info.isLegal(moves[nodes[n].move]))
+            children.push_back(n);
+
+    return children;
+}
+
+template<typename State, typename Agent, typename Policy>
+typename State::Move MCTS<State, Agent, Policy>::singleMove() const {
+    // the moves of the observer are the same in every sample, the moves of another player aren't
+    if (root_info.observer != root_info.playerToMove)
+        return Move::null();
+
+    // the sample has its own rng, so that asking doesn't change the course of the search
+    std::mt19937 local(0);
+    typename State::MoveGenerator generator = root_info.sample(local).moveGenerator();
+    Move move;
+
+    if (generator.size() != 1 || !generator.next(move))
+        return Move::null();
 
-    return (*best)->move;
+    return move;
 }
 
-template<typename State, typename Agent>
-void MCTS<State, Agent>::loop(size_t iters) const {
-    loop(root, root_state, iters);
+template<typename State, typename Agent, typename Policy>
+typename MCTS<State, Agent, Policy>::Progress MCTS<State, Agent, Policy>::progress() const {
+    Progress progress;
+    progress.visits = nodes.at(root).visits;
+
+    size_t most = 0;
+
+    for (uint32_t n : rootChildren()) {
+        const Node& child = nodes[n];
+        progress.children.push_back({moves[child.move], child.visits, child.wins});
+
+        if (progress.best.isNull() || child.visits > most) {
+            progress.best = moves[child.move];
+            most = child.visits;
+        }
+    }
+
+    return progress;
 }
 
-template<typename State, typename Agent>
-State MCTS<State, Agent>::iterate() const {
-    return iterate(root, root_state);
+template<typename State, typename Agent, typename Policy>
+typename MCTS<State, Agent, Policy>::Memory MCTS<State, Agent, Policy>::memory() const {
+    Memory memory;
+    memory.nodes = nodes.size();
+    memory.nodeBytes = nodes.capacity() * sizeof(Node) + amaf.capacity() * sizeof(Amaf) +
+                       stats.capacity() * sizeof(Stats) + priors.capacity() * sizeof(float);
+    // a hash table entry is the key, the value and a pointer, plus a bucket pointer
+    memory.moveBytes = moves.capacity() * sizeof(Move) +
+                       moveIds.size() * (sizeof(typename decltype(moveIds)::value_type) + sizeof(void*)) +
+                       moveIds.bucket_count() * sizeof(void*);
+
+    std::vector<uint32_t> stack = {root};
+
+    while (!stack.empty()) {
+        uint32_t node = stack.back();
+        stack.pop_back();
+        ++memory.reachable;
+
+        for (uint32_t n = nodes[node].firstChild; n != None; n = nodes[n].nextSibling)
+            stack.push_back(n);
+    }
+
+    return memory;
 }
 
-template<typename State, typename Agent>
-void MCTS<State, Agent>::loop(MCTS::NodePtr node, const State& initial, size_t iters) const {
-    State state = determinize(initial);
+template<typename State, typename Agent, typename Policy>
+typename State::Move MCTS<State, Agent, Policy>::getMove(size_t iters, const StopToken& stop,
+                                                    const ProgressCallback& progress, size_t every) const {
+    saved = 0;
+
+    if (Move move = bookMove(); !move.isNull())
+        return move;
+
+    every = std::max<size_t>(every, 1);
+
+    for (size_t made = 0; made < iters && !stop.stopRequested();) {
+        if (made > 0 && isDecided(iters - made)) {
+            saved = iters - made;
+
+            if (output)
+                *output << "Decided early, saved " << saved << " of " << iters << " iterations" << std::endl;
+
+            break;
+        }
+
+        // the stop is checked between small steps, which never jump over a report
+        size_t step = std::min<size_t>({64, iters - made, every - made % every});
+
+        loop(step);
+        made += step;
+
+        if (progress && (made % every == 0 || made == iters)) {
+            Progress p = this->progress();
+            p.iterations = made;
+            progress(p);
+        }
+    }
+
+    return bestMove();
+}
+
+template<typename State, typename Agent, typename Policy>
+typename State::Move MCTS<State, Agent, Policy>::getMove(TimeManager& clock) const {
+    TimeManager::Clock::time_point start = TimeManager::Clock::now();
+    auto elapsed = [start] {
+        return std::chrono::duration_cast<TimeManager::Duration>(TimeManager::Clock::now() - start);
+    };
+
+    saved = 0;
+    Move move = bookMove();
+
+    if (move.isNull())
+        move = singleMove();
+
+    if (!move.isNull()) {
+        clock.charge(elapsed());
+        return move;
+    }
+
+    TimeManager::Budget budget = clock.budget(root_info.expectedMoves(), root_info.criticality());
+    uint32_t best = None;
+    TimeManager::Duration changed(0); // when the best move changed the last time
+
+    // at least one step, so that there is a move to return even when the clock is out
+    do {
+        loop(64);
+
+        uint32_t first = None, second = None;
+
+        for (uint32_t n : rootChildren()) {
+            if (first == None || nodes[n].visits > nodes[first].visits) {
+                second = first;
+                first = n;
+            } else if (second == None || nodes[n].visits > nodes[second].visits) {
+                second = n;
+            }
+        }
+
+        if (first != best) {
+            best = first;
+            changed = elapsed();
+        }
+
+        if (elapsed() < budget.target)
+            continue;
+
+        // unstable: the best move changed during the last quarter of the target or has a small lead
+        bool recent = elapsed() - changed < budget.target / 4;
+        bool close = second != None && nodes[first].visits < 1.5 * nodes[second].visits;
+
+        if (!recent && !close)
+            break;
+    } while (elapsed() < budget.limit);
+
+    clock.charge(elapsed());
+    return bestMove();
+}
+
+template<typename State, typename Agent, typename Policy>
+bool MCTS<State, Agent, Policy>::isDecided(size_t remaining) const {
+    const Node& r = nodes.at(root);
+
+    if (earlyStop == EarlyStop::Never || r.firstChild == None)
+        return false;
+
+    // a single legal move needs no search
+    if (nodes[r.firstChild].nextSibling == None && !singleMove().isNull())
+        return true;
+
+    std::vector<uint32_t> children = rootChildren();
+
+    if (children.empty())
+        return false;
+
+    uint32_t best = children.front();
+    for (uint32_t n : children)
+        if (nodes[n].visits > nodes[best].visits)
+            best = n;
+
+    uint32_t second = 0;
+    for (uint32_t n : children)
+        if (n != best)
+            second = std::max(second, nodes[n].visits);
+
+    // every iteration visits one root move, so the others can't collect more than remaining visits
+    if (nodes[best].visits > second + remaining)
+        return true;
+
+    if (earlyStop != EarlyStop::Confidence)
+        return false;
+
+    // the moves which aren't expanded yet aren't taken into account
+    auto radius = [this](uint32_t visits) { return std::sqrt(std::log(1 / earlyStopDelta) / (2.0 * visits)); };
+    double lower = nodes[best].wins / nodes[best].visits - radius(nodes[best].visits);
+
+    for (uint32_t n : children)
+        if (n != best && (nodes[n].visits == 0 || nodes[n].wins / nodes[n].visits + radius(nodes[n].visits) >= lower))
+            return false;
+
+    return true;
+}
+
+template<typename State, typename Agent, typename Policy>
+typename MCTS<State, Agent, Policy>::AsyncMove
+MCTS<State, Agent, Policy>::getMoveAsync(size_t iters, ProgressCallback progress, size_t every) const {
+    AsyncMove result;
+    StopToken stop = result.stop.token();
+
+    result.move = std::async(std::launch::async, [this, iters, stop, progress = std::move(progress), every] {
+        return getMove(iters, stop, progress, every);
+    });
+
+    return result;
+}
+
+template<typename State, typename Agent, typename Policy>
+template<typename Evaluator>
+typename State::Move MCTS<State, Agent, Policy>::getMoveBatched(size_t iters, const Evaluator& evaluator,
+                                                                    size_t batch) const {
+    saved = 0;
+
+    if (Move move = bookMove(); !move.isNull())
+        return move;
+
+    loopBatched(iters, evaluator, batch);
+    return bestMove();
+}
+
+template<typename State, typename Agent, typename Policy>
+template<typename Evaluator>
+void MCTS<State, Agent, Policy>::loopBatched(size_t iters, const Evaluator& evaluator, size_t batch) const {
+    batch = std::max<size_t>(batch, 1);
+    growSideArrays();
+
+    std::vector<State> leaves(std::min(batch, iters), root_info.sample(rng));
+    std::vector<std::vector<uint32_t>> paths(leaves.size());
+    std::vector<std::vector<std::pair<uint32_t, int>>> playedMoves(leaves.size());
+    std::vector<double> values;
+
+    for (size_t made = 0; made < iters;) {
+        size_t count = std::min(batch, iters - made);
+        leaves.resize(count, leaves.front());
+
+        for (size_t i = 0; i < count; ++i) {
+            determinize(root_info, leaves[i]);
+            select(root, leaves[i]);
+
+            // the virtual loss: a visit without a win until the evaluation comes
+            for (uint32_t n : path)
+                nodes[n].visits += 1;
+
+            paths[i].swap(path);
+            playedMoves[i].swap(played);
+        }
+
+        values.clear();
+        evaluator.evaluate(leaves, values);
+
+        for (size_t i = 0; i < count; ++i) {
+            const State& leaf = leaves[i];
+            const double* value = values.data() + i * leaf.numberOfPlayers;
+
+            path.swap(paths[i]);
+            played.swap(playedMoves[i]);
+
+            if (leaf.isTerminal())
+                backpropagate([&leaf](int player) { return leaf.getResult(player); }, true);
+            else
+                backpropagate([value](int player) { return value[player - 1]; }, true);
+        }
+
+        made += count;
+    }
+}
+
+template<typename State, typename Agent, typename Policy>
+void MCTS<State, Agent, Policy>::loop(size_t iters) const {
+    loop(root, root_info, iters);
+}
+
+template<typename State, typename Agent, typename Policy>
+void MCTS<State, Agent, Policy>::iterate() const {
+    loop(root, root_info, 1);
+}
+
+template<typename State, typename Agent, typename Policy>
+void MCTS<State, Agent, Policy>::loop(uint32_t node, const InformationSet& initial, size_t iters) const {
+    // the only state of the loop, every iteration overwrites it with a new determinization
+    State state = initial.sample(rng);
+
+    growSideArrays();
 
     for (size_t i = 1; i <= iters; ++i)
-        iterate(node, state);
+        iterate(node, initial, state);
 }
 
-template<typename State, typename Agent>
-State MCTS<State, Agent>::iterate(MCTS::NodePtr node, const State& initial) const {
+template<typename State, typename Agent, typename Policy>
+void MCTS<State, Agent, Policy>::iterate(uint32_t node, const InformationSet& initial, State& state) const {
 
     // Determinize
-    State state = determinize(initial);
+    determinize(initial, state);
 
     // Selection and expansion
-    node = select(node, state);
+    select(node, state);
 
     // Simulation
     rollout(state, agent);
 
     // Backpropagation
-    while (node) {
-        node->update(state);
-        node = node->parent.lock();
+    backpropagate([&state](int player) { return state.getResult(player); }, false);
+}
+
+template<typename State, typename Agent, typename Policy>
+template<typename Result>
+void MCTS<State, Agent, Policy>::backpropagate(const Result& result, bool visited) const {
+    for (uint32_t n : path) {
+        Node& node = nodes[n];
+
+        if (!visited)
+            node.visits += 1;
+
+        if (node.justMoved != -1) {
+            double r = result(node.justMoved);
+            node.wins += r;
+
+            if constexpr (hasStats)
+                policy.update(stats[n], r);
+        }
     }
 
-    return state;
+    if (rave > 0)
+        updateAmaf(result);
 }
 
-template<typename State, typename Agent>
-State MCTS<State, Agent>::determinize(const State& state) const {
-    State newState(state);
-    newState.randomizeHiddenState();
-    return newState;
+template<typename State, typename Agent, typename Policy>
+void MCTS<State, Agent, Policy>::determinize(const InformationSet& info, State& state) const {
+    info.sample(state, rng);
 }
 
-template<typename State, typename Agent>
-typename MCTS<State, Agent>::NodePtr
-MCTS<State, Agent>::select(MCTS::NodePtr node, State& state) const {
-    std::vector<MovePtr> legalMoves = state.getMoves();
-    std::vector<MovePtr> untried = node->getUntriedMoves(legalMoves);
+template<typename State, typename Agent, typename Policy>
+uint32_t MCTS<State, Agent, Policy>::select(uint32_t node, State& state) const {
+    path.clear();
+    path.push_back(node);
+    played.clear();
 
     while (!state.isTerminal()) {
-        if (!untried.empty()) {
-            return expand(node, state, untried);
+        getLegalChildren(node, state);
+
+        if constexpr (hasPriors) {
+            // a node reached for the first time in this determinization gets all its moves at once,
+            // the policy weighs the new children by their priors against the visited ones
+            if (expandAll(node, state))
+                getLegalChildren(node, state);
+
+            widenByPriors(node);
+            node = selectChild();
+            state.makeMoveUnchecked(moves[nodes[node].move]);
+            path.push_back(node);
+
+            if (rave > 0)
+                played.emplace_back(nodes[node].move, nodes[node].justMoved);
+
+            // the first visit of a child ends the descent as the expansion of a single move does
+            if (nodes[node].visits == 0)
+                return node;
+
+            continue;
+        }
+
+        if (canWiden(node, legal.size())) {
+            Move move;
+
+            if (getUntriedMove(node, state, move)) {
+                node = expand(node, state, move);
+                path.push_back(node);
+
+                if (rave > 0)
+                    played.emplace_back(nodes[node].move, nodes[node].justMoved);
+
+                return node;
+            }
         }
 
-        node = node->UCBSelectChild(legalMoves, this->exploration);
-        state.makeMove(node->move);
+        node = selectChild();
+        // the children are needed right after the move is made, fetch them while it's being made
+        if (nodes[node].firstChild != None)
+            __builtin_prefetch(&nodes[nodes[node].firstChild]);
 
-        legalMoves = state.getMoves();
-        untried = node->getUntriedMoves(legalMoves);
+        state.makeMoveUnchecked(moves[nodes[node].move]);
+        path.push_back(node);
+
+        if (rave > 0)
+            played.emplace_back(nodes[node].move, nodes[node].justMoved);
     }
 
     return node;
 }
 
-template<typename State, typename Agent>
-typename MCTS<State, Agent>::NodePtr
-MCTS<State, Agent>::expand(MCTS::NodePtr node, State& state, const std::vector<MovePtr>& untried) const {
-    MovePtr move = untried[(rand() % untried.size())];
+template<typename State, typename Agent, typename Policy>
+uint32_t MCTS<State, Agent, Policy>::expand(uint32_t node, State& state, const Move& move) const {
     int justMoved = state.playerToMove;
-    state.makeMove(move);
-    return node->addChild(move, justMoved);
+    state.makeMoveUnchecked(move);
+    return addChild(node, move, justMoved);
+}
+
+template<typename State, typename Agent, typename Policy>
+bool MCTS<State, Agent, Policy>::canWiden(uint32_t node, size_t legalChildren) const {
+    if (legalChildren == 0 || widening <= 0)
+        return true;
+
+    double limit = widening * std::pow(static_cast<double>(nodes[node].visits), wideningExponent);
+    return static_cast<double>(legalChildren) < std::max(1.0, limit);
+}
+
+template<typename State, typename Agent, typename Policy>
+bool MCTS<State, Agent, Policy>::expandAll(uint32_t node, const State& state) const {
+    typename State::MoveGenerator generator = state.moveGenerator();
+    markTried(node);
+
+    bool added = false;
+    Move move;
+
+    while (generator.next(move)) {
+        if (isTried(move))
+            continue;
+
+        // the prior is taken once, in the state the move is made from
+        float prior = agent.prior(state, move);
+        uint32_t child = addChild(node, move, state.playerToMove);
+        priors[child] = prior;
+        added = true;
+    }
+
+    return added;
 }
 
-template<typename State, typename Agent>
-void MCTS<State, Agent>::rollout(State& state, const Agent& agent) const {
+template<typename State, typename Agent, typename Policy>
+void MCTS<State, Agent, Policy>::widenByPriors(uint32_t node) const {
+    if (widening <= 0)
+        return;
+
+    double limit = widening * std::pow(static_cast<double>(nodes[node].visits), wideningExponent);
+    size_t keep = static_cast<size_t>(std::max(1.0, limit));
+
+    // the children with the highest priors come in first, the rest wait for the visits of the node
+    if (legal.size() > keep) {
+        std::partial_sort(legal.begin(), legal.begin() + keep, legal.end(),
+                          [this](uint32_t a, uint32_t b) { return priors[a] > priors[b]; });
+        legal.resize(keep);
+    }
+}
+
+template<typename State, typename Agent, typename Policy>
+void MCTS<State, Agent, Policy>::rollout(State& state, const Agent& agent) const {
     while (!state.isTerminal()) {
-        MovePtr move = agent.getMove(state);
-        state.makeMove(move);
+        Move move = agent.getMove(state);
+
+        // a move which isn't in the table isn't the move of any node, so there is nothing to credit
+        if (rave > 0) {
+            auto it = moveIds.find(State::recordMove(move));
+            if (it != moveIds.end())
+                played.emplace_back(it->second, state.playerToMove);
+        }
+
+        state.makeMoveUnchecked(move);
     }
 }
 
-template<typename State, typename Agent>
-void MCTS<State, Agent>::makeMove(const MovePtr& move) {
-    NodePtr child;
+template<typename State, typename Agent, typename Policy>
+template<typename Result>
+void MCTS<State, Agent, Policy>::updateAmaf(const Result& result) const {
+    auto key = [](uint32_t move, int player) {
+        return static_cast<uint64_t>(move) << 32 | static_cast<uint32_t>(player);
+    };
+
+    lastPlayed.clear();
+    for (uint32_t i = 0; i < played.size(); ++i)
+        lastPlayed[key(played[i].first, played[i].second)] = i;
+
+    // the children of path[i] are the moves at index i of played, a child is credited when its player
+    // made its move at that index or later
+    for (size_t i = 0; i < path.size(); ++i) {
+        for (uint32_t n = nodes[path[i]].firstChild; n != None; n = nodes[n].nextSibling) {
+            auto it = lastPlayed.find(key(nodes[n].move, nodes[n].justMoved));
+
+            if (it != lastPlayed.end() && it->second >= i) {
+                amaf[n].visits += 1;
+                amaf[n].wins += result(nodes[n].justMoved);
+            }
+        }
+    }
+}
+
+template<typename State, typename Agent, typename Policy>
+typename State::Move MCTS<State, Agent, Policy>::bookMove() const {
+    if (!book)
+        return Move::null();
+
+    const OpeningBook::Entry* entry = book->find(root_info.canonicalKey());
 
-    for (const NodePtr& n : root->children) {
-        if (n->move == move) {
+    if (!entry)
+        return Move::null();
+
+    Move move = root_info.fromCanonicalMove(entry->move);
+
+    if (move.isNull())
+        return move;
+
+    if (output)
+        *output << "Book move: " << entry->visits << "/" << entry->total << std::endl;
+
+    return move;
+}
+
+template<typename State, typename Agent, typename Policy>
+void MCTS<State, Agent, Policy>::makeMove(const Move& move, const InformationSet& observed) {
+    uint32_t id = moveId(move);
+    uint32_t child = None;
+
+    for (uint32_t n = nodes.at(root).firstChild; n != None; n = nodes[n].nextSibling) {
+        if (nodes[n].move == id) {
             child = n;
             break;
         }
     }
 
-    if (!child) {
-        child = root->addChild(move, root_state.playerToMove);
+    if (child == None) {
+        child = addChild(root, move, root_info.playerToMove);
+
+        if constexpr (hasPriors)
+            priors[child] = agent.prior(root_info.sample(rng), move);
     }
 
     root = child;
-    root_state.makeMove(move);
+    root_info = observed;
 }
 
-template<typename State, typename Agent>
-MCTS<State, Agent>::Node::Node(MovePtr m, MCTS::Node::Ptr parent, int p):
-        move(m), parent(parent), just_moved(p), wins(0.0), visits(0), avails(1) {
+template<typename State, typename Agent, typename Policy>
+void MCTS<State, Agent, Policy>::gather(Layout layout, std::vector<Node>& newNodes,
+                                        std::vector<Move>& newMoves, std::vector<uint32_t>& origin) const {
+    std::vector<uint32_t> newIds(moves.size(), None);
+
+    // copies a node without its children, returning its new index
+    auto copy = [&](uint32_t n) {
+        Node node = nodes[n];
+        node.firstChild = node.nextSibling = None;
+
+        if (n == root) {
+            node.move = None;
+        } else {
+            if (newIds[node.move] == None) {
+                newIds[node.move] = newMoves.size();
+                newMoves.push_back(moves[node.move]);
+            }
+
+            node.move = newIds[node.move];
+        }
+
+        newNodes.push_back(node);
+        origin.push_back(n);
+
+        return static_cast<uint32_t>(newNodes.size() - 1);
+    };
+
+    // copies the children of from after the already copied node to, keeping their order
+    auto copyChildren = [&](uint32_t from, uint32_t to, std::vector<std::pair<uint32_t, uint32_t>>& copied) {
+        std::vector<uint32_t> children;
+        for (uint32_t n = nodes[from].firstChild; n != None; n = nodes[n].nextSibling)
+            children.push_back(n);
+
+        std::vector<uint32_t> order(children.size());
+        for (size_t i = 0; i < order.size(); ++i)
+            order[i] = i;
+
+        // in the hot path layout the children are placed from the most visited one
+        if (layout == Layout::HotPathFirst)
+            std::stable_sort(order.begin(), order.end(), [this, &children](uint32_t a, uint32_t b) {
+                return nodes[children[a]].visits > nodes[children[b]].visits;
+            });
+
+        std::vector<uint32_t> placed(children.size());
+        for (uint32_t i : order)
+            placed[i] = copy(children[i]);
+
+        for (size_t i = 0; i < children.size(); ++i) {
+            if (i == 0)
+                newNodes[to].firstChild = placed[i];
+            else
+                newNodes[placed[i - 1]].nextSibling = placed[i];
+        }
+
+        copied.clear();
+        for (uint32_t i : order)
+            copied.emplace_back(children[i], placed[i]);
+    };
+
+    newNodes.clear();
+    newMoves.clear();
+    origin.clear();
+    copy(root);
 
+    std::vector<std::pair<uint32_t, uint32_t>> pending = {{root, 0}}, copied;
+
+    if (layout == Layout::BreadthFirst) {
+        for (size_t i = 0; i < pending.size(); ++i) {
+            copyChildren(pending[i].first, pending[i].second, copied);
+            pending.insert(pending.end(), copied.begin(), copied.end());
+        }
+    } else {
+        while (!pending.empty()) {
+            auto [from, to] = pending.back();
+            pending.pop_back();
+
+            copyChildren(from, to, copied);
+            // the most visited child goes on top of the stack, so its subtree follows it in memory
+            pending.insert(pending.end(), copied.rbegin(), copied.rend());
+        }
+    }
 }
 
-template<typename State, typename Agent>
-void MCTS<State, Agent>::Node::update(const State& state) {
-    visits += 1;
+template<typename State, typename Agent, typename Policy>
+void MCTS<State, Agent, Policy>::indexMoves() const {
+    moveIds.clear();
 
-    if (just_moved != -1)
-        wins += state.getResult(just_moved);
+    for (size_t i = 0; i < moves.size(); ++i)
+        moveIds.emplace(State::recordMove(moves[i]), i);
 }
 
-template<typename State, typename Agent>
-typename MCTS<State, Agent>::NodePtr MCTS<State, Agent>::Node::addChild(MovePtr m, int p) {
-    NodePtr node = std::make_shared<Node>(m, this->shared_from_this(), p);
-    children.push_back(node);
-    return node;
+template<typename State, typename Agent, typename Policy>
+void MCTS<State, Agent, Policy>::compact(Layout layout) {
+    std::vector<Node> newNodes;
+    std::vector<Move> newMoves;
+    std::vector<uint32_t> origin;
+    newNodes.reserve(memory().reachable);
+
+    gather(layout, newNodes, newMoves, origin);
+
+    // the side arrays follow the nodes
+    auto follow = [&origin](auto& side) {
+        if (side.empty())
+            return;
+
+        std::remove_reference_t<decltype(side)> moved;
+        moved.reserve(origin.size());
+
+        for (uint32_t n : origin)
+            moved.push_back(side[n]);
+
+        side = std::move(moved);
+    };
+
+    follow(amaf);
+    follow(stats);
+    follow(priors);
+
+    nodes = std::move(newNodes);
+    moves = std::move(newMoves);
+    root = 0;
+    indexMoves();
 }
 
-template<typename State, typename Agent>
-std::vector<typename State::MovePtr>
-MCTS<State, Agent>::Node::getUntriedMoves(const std::vector<MovePtr>& legalMoves) const {
-    std::unordered_set<MovePtr, SharedHash<Move>, SharedEqual<Move>> tried;
-    tried.reserve(children.size());
+template<typename State, typename Agent, typename Policy>
+void MCTS<State, Agent, Policy>::snapshot(const std::string& path) const {
+    std::vector<Node> tree;
+    std::vector<Move> treeMoves;
+    std::vector<uint32_t> origin;
+    gather(Layout::BreadthFirst, tree, treeMoves, origin);
 
-    for (auto it = children.begin(); it != children.end(); ++it) {
-        tried.emplace((*it)->move);
+    std::vector<MoveRecord> records;
+    records.reserve(treeMoves.size());
+
+    for (const Move& move : treeMoves)
+        records.push_back(State::recordMove(move));
+
+    // the side arrays may be shorter than nodes before the first search
+    std::vector<Stats> treeStats;
+    std::vector<float> treePriors;
+
+    for (uint32_t n : origin) {
+        if constexpr (hasStats)
+            treeStats.push_back(n < stats.size() ? stats[n] : Stats());
+        if constexpr (hasPriors)
+            treePriors.push_back(n < priors.size() ? priors[n] : 1);
     }
 
-    std::vector<MovePtr> untried;
+    std::string info;
+    root_info.write(info);
+
+    SnapshotHeader header{{'M', 'C', 'T', 'S', 'T', 'R', 'E', 'E'}, sizeof(Node),
+                          static_cast<uint32_t>(records.size()), tree.size(), info.size(),
+                          hasStats ? static_cast<uint32_t>(sizeof(Stats)) : 0, hasPriors ? sizeof(float) : 0};
+    SnapshotLayout layout = snapshotLayout(header);
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+
+    // writes a block at its offset, padding the gap before it with zeros
+    auto block = [&out](uint64_t offset, const void* data, size_t size) {
+        while (static_cast<uint64_t>(out.tellp()) < offset)
+            out.put(0);
+
+        out.write(static_cast<const char*>(data), size);
+    };
+
+    block(0, &header, sizeof(header));
+    block(sizeof(header), tree.data(), tree.size() * sizeof(Node));
+    block(layout.records, records.data(), records.size() * sizeof(MoveRecord));
+    block(layout.stats, treeStats.data(), treeStats.size() * header.statsSize);
+    block(layout.priors, treePriors.data(), treePriors.size() * header.priorSize);
+    block(layout.info, info.data(), info.size());
+
+    if (!out)
+        throw std::runtime_error("Can't write snapshot " + path);
+}
+
+template<typename State, typename Agent, typename Policy>
+void MCTS<State, Agent, Policy>::restore(const std::string& path) {
+    restore(path, nullptr);
+}
+
+template<typename State, typename Agent, typename Policy>
+void MCTS<State, Agent, Policy>::restore(const std::string& path, const InformationSet& expected) {
+    restore(path, &expected);
+}
+
+template<typename State, typename Agent, typename Policy>
+void MCTS<State, Agent, Policy>::restore(const std::string& path, const InformationSet* expected) {
+    MappedFile file(path);
+
+    if (file.size() < sizeof(SnapshotHeader))
+        throw std::runtime_error("Bad snapshot " + path + ": no header");
+
+    const SnapshotHeader* header = reinterpret_cast<const SnapshotHeader*>(file.data());
+
+    if (std::memcmp(header->magic, "MCTSTREE", sizeof(header->magic)) != 0 || header->nodeSize != sizeof(Node) ||
+        header->nodes == 0 || (header->priorSize != 0 && header->priorSize != sizeof(float)) ||
+        file.size() != snapshotLayout(*header).size)
+        throw std::runtime_error("Bad snapshot " + path + ": wrong magic or size");
+
+    // the policy statistics go with the results of the nodes, UCB1Tuned can't take a variance of nothing
+    if (header->statsSize != (hasStats ? sizeof(Stats) : 0))
+        throw std::runtime_error("Bad snapshot " + path + ": taken with another policy");
+
+    SnapshotLayout layout = snapshotLayout(*header);
+    const Node* tree = reinterpret_cast<const Node*>(header + 1);
+    const MoveRecord* records = reinterpret_cast<const MoveRecord*>(file.data() + layout.records);
+    const Stats* treeStats = reinterpret_cast<const Stats*>(file.data() + layout.stats);
+    const float* treePriors = reinterpret_cast<const float*>(file.data() + layout.priors);
+    const char* infoBytes = reinterpret_cast<const char*>(file.data() + layout.info);
+    InformationSet info = InformationSet::read(infoBytes, header->infoBytes);
 
-    for (const MovePtr& m : legalMoves) {
-        auto it = tried.find(m);
-        if (it == tried.end())
-            untried.push_back(m);
+    if (expected) {
+        std::string bytes;
+        expected->write(bytes);
+
+        if (bytes.size() != header->infoBytes || std::memcmp(bytes.data(), infoBytes, bytes.size()) != 0)
+            throw std::runtime_error("Bad snapshot " + path + ": taken at another position");
     }
 
-    return untried;
+    auto bad = [header](uint32_t index, uint64_t size) { return index != None && index >= size; };
+
+    for (size_t i = 0; i < header->nodes; ++i)
+        if (bad(tree[i].firstChild, header->nodes) || bad(tree[i].nextSibling, header->nodes) ||
+            bad(tree[i].move, header->moves) || (i > 0 && tree[i].move == None))
+            throw std::runtime_error("Bad snapshot " + path + ": node " + std::to_string(i) + " is broken");
+
+    // every node is reached from the root once, a cycle or a shared node would make the traversals loop
+    std::vector<bool> reached(header->nodes);
+    std::vector<uint32_t> pending{0};
+    reached[0] = true;
+
+    while (!pending.empty()) {
+        uint32_t n = pending.back();
+        pending.pop_back();
+
+        for (uint32_t child = tree[n].firstChild; child != None; child = tree[child].nextSibling) {
+            if (reached[child])
+                throw std::runtime_error("Bad snapshot " + path + ": node " + std::to_string(child) +
+                                         " is reached twice");
+
+            reached[child] = true;
+            pending.push_back(child);
+        }
+    }
+
+    std::vector<Move> newMoves;
+    newMoves.reserve(header->moves);
+
+    for (size_t i = 0; i < header->moves; ++i)
+        newMoves.push_back(State::restoreMove(records[i]));
+
+    nodes.assign(tree, tree + header->nodes);
+    moves = std::move(newMoves);
+    amaf.clear();
+    stats.clear();
+    priors.clear();
+
+    if constexpr (hasStats)
+        stats.assign(treeStats, treeStats + header->nodes);
+    if constexpr (hasPriors)
+        if (header->priorSize)
+            priors.assign(treePriors, treePriors + header->nodes);
+    root = 0;
+    root_info = info;
+    indexMoves();
+}
+
+template<typename State, typename Agent, typename Policy>
+typename MCTS<State, Agent, Policy>::SnapshotLayout
+MCTS<State, Agent, Policy>::snapshotLayout(const SnapshotHeader& header) {
+    auto align = [](uint64_t offset, uint64_t alignment) { return (offset + alignment - 1) / alignment * alignment; };
+
+    SnapshotLayout layout;
+    layout.records = align(sizeof(SnapshotHeader) + header.nodes * header.nodeSize, alignof(MoveRecord));
+    layout.stats = align(layout.records + header.moves * sizeof(MoveRecord), alignof(Stats));
+    layout.priors = align(layout.stats + header.nodes * header.statsSize, alignof(float));
+    layout.info = layout.priors + header.nodes * header.priorSize;
+    layout.size = layout.info + header.infoBytes;
+    return layout;
 }
 
-template<typename State, typename Agent>
-typename MCTS<State, Agent>::NodePtr
-MCTS<State, Agent>::Node::UCBSelectChild(const std::vector<MovePtr>& legalMoves, double exploration) const {
-    std::unordered_set<MovePtr, SharedHash<Move>, SharedEqual<Move>> moves(legalMoves.begin(), legalMoves.end());
-    std::vector<NodePtr> legalChildren;
+template<typename State, typename Agent, typename Policy>
+void MCTS<State, Agent, Policy>::getLegalChildren(uint32_t node, const State& state) const {
+    legal.clear();
 
-    for (const NodePtr& n : children) {
-        if (moves.find(n->move) != moves.end())
-            legalChildren.push_back(n);
+    for (uint32_t n = nodes[node].firstChild; n != None; n = nodes[n].nextSibling) {
+        if (state.isLegal(moves[nodes[n].move]))
+            legal.push_back(n);
     }
+}
+
+template<typename State, typename Agent, typename Policy>
+bool MCTS<State, Agent, Policy>::getUntriedMove(uint32_t node, const State& state, Move& move) const {
+    // the generator yields moves by decreasing priority, so the first untried one is the most promising.
+    // The children aren't counted against the generator: a child made in another determinization may be
+    // legal here without being one of the generated moves, e.g. another way to beat the same cards
+    typename State::MoveGenerator generator = state.moveGenerator();
+    markTried(node);
 
-    std::vector<double> ucbs;
-    ucbs.reserve(legalChildren.size());
+    while (generator.next(move))
+        if (!isTried(move))
+            return true;
 
-    for (const NodePtr& n : legalChildren) {
-        ucbs.push_back(n->ucb());
+    return false;
+}
+
+template<typename State, typename Agent, typename Policy>
+void MCTS<State, Agent, Policy>::markTried(uint32_t node) const {
+    // the marks of the earlier calls are smaller, they only have to be cleared when the counter wraps
+    if (++triedMark == 0) {
+        std::fill(tried.begin(), tried.end(), 0);
+        triedMark = 1;
     }
 
-    double max = ucbs.at(0);
-    long long ind = 0;
+    tried.resize(moves.size());
+    for (uint32_t n = nodes[node].firstChild; n != None; n = nodes[n].nextSibling)
+        tried[nodes[n].move] = triedMark;
+}
 
-    for (long long i = 1; i < ucbs.size(); ++i) {
-        if (ucbs.at(i) > max) {
-            max = ucbs.at(i);
-            ind = i;
+template<typename State, typename Agent, typename Policy>
+bool MCTS<State, Agent, Policy>::isTried(const Move& move) const {
+    auto it = moveIds.find(State::recordMove(move));
+    return it != moveIds.end() && it->second < tried.size() && tried[it->second] == triedMark;
+}
+
+template<typename State, typename Agent, typename Policy>
+uint32_t MCTS<State, Agent, Policy>::selectChild() const {
+    arms.clear();
+
+    double total = 0;
+    float visitedWins = 0;
+    uint32_t visitedVisits = 0;
+
+    if constexpr (hasPriors)
+        for (uint32_t n : legal) {
+            total += priors[n];
+            visitedWins += nodes[n].wins;
+            visitedVisits += nodes[n].visits;
+        }
+
+    for (size_t i = 0; i < legal.size(); ++i) {
+        if (i + 1 < legal.size())
+            __builtin_prefetch(&nodes[legal[i + 1]]);
+
+        const Node& node = nodes[legal[i]];
+        double value = node.visits ? node.wins / node.visits : visitedVisits ? visitedWins / visitedVisits : 0;
+
+        // (1 - beta) * value + beta * AMAF value
+        if (rave > 0 && amaf[legal[i]].visits > 0) {
+            double beta = std::sqrt(rave / (3.0 * node.visits + rave));
+            value += beta * (amaf[legal[i]].wins / amaf[legal[i]].visits - value);
         }
+
+        Stats* stats = &noStats;
+        if constexpr (hasStats)
+            stats = &this->stats[legal[i]];
+
+        double prior = 1.0 / legal.size();
+        if constexpr (hasPriors)
+            if (total > 0)
+                prior = priors[legal[i]] / total;
+
+        arms.push_back({value, node.wins, node.visits, node.avails, prior, stats});
+    }
+
+    uint32_t best = legal[policy.select(arms, rng)];
+
+    for (uint32_t n : legal) {
+        nodes[n].avails += 1;
     }
 
-    for (const NodePtr& n : legalChildren) {
-        n->avails += 1;
+    return best;
+}
+
+template<typename State, typename Agent, typename Policy>
+uint32_t MCTS<State, Agent, Policy>::addChild(uint32_t node, const Move& move, int justMoved) const {
+    uint32_t child = nodes.size();
+    nodes.emplace_back(moveId(move), justMoved);
+    growSideArrays();
+
+    if (nodes[node].firstChild == None) {
+        nodes[node].firstChild = child;
+    } else {
+        uint32_t last = nodes[node].firstChild;
+
+        while (nodes[last].nextSibling != None)
+            last = nodes[last].nextSibling;
+
+        nodes[last].nextSibling = child;
     }
 
-    return legalChildren.at(ind);
+    return child;
+}
+
+template<typename State, typename Agent, typename Policy>
+uint32_t MCTS<State, Agent, Policy>::moveId(const Move& move) const {
+    auto [it, added] = moveIds.emplace(State::recordMove(move), moves.size());
+
+    if (added)
+        moves.push_back(move);
+
+    return it->second;
 }
 
-template<typename State, typename Agent>
-double MCTS<State, Agent>::Node::ucb(double exploration) const {
-    return static_cast<double>(wins) / static_cast<double>(visits) +
-           +exploration * sqrt(log(avails) / static_cast<double>(visits));
+template<typename State, typename Agent, typename Policy>
+void MCTS<State, Agent, Policy>::growSideArrays() const {
+    if (rave > 0 || !amaf.empty())
+        amaf.resize(nodes.size());
+
+    if constexpr (hasStats)
+        stats.resize(nodes.size());
+
+    // the nodes restored from a snapshot have no priors, they get equal ones
+    if constexpr (hasPriors)
+        priors.resize(nodes.size(), 1);
 }
 
 template<typename State>
-typename State::MovePtr RandomAgent<State>::getMove(State& state) const {
+typename State::Move RandomAgent<State>::getMove(State& state) const {
     return state.randomMove();
 }
 
-#endif //MCTS_MCTS_H
\ No newline at end of file
+#endif //MCTS_MCTS_H
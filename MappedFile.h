@@ -0,0 +1,83 @@
+#ifndef MCTS_MAPPEDFILE_H
+#define MCTS_MAPPEDFILE_H
+
+#include <string>
+#include <utility>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// A whole file mapped read-only into memory, the binary formats are read straight from it without copying
+class MappedFile {
+public:
+    MappedFile() = default;
+    explicit MappedFile(const std::string& path); // throws std::runtime_error if the file can't be mapped
+    ~MappedFile();
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const { return static_cast<const char*>(address); }
+    size_t size() const { return length; }
+
+private:
+    void* address = nullptr; // nullptr for an empty file
+    size_t length = 0;
+};
+
+inline MappedFile::MappedFile(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+
+    if (fd < 0)
+        throw std::runtime_error("Can't open " + path);
+
+    struct stat info{};
+
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        throw std::runtime_error("Can't stat " + path);
+    }
+
+    length = info.st_size;
+
+    if (length > 0) {
+        address = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+
+        if (address == MAP_FAILED) {
+            address = nullptr;
+            close(fd);
+            throw std::runtime_error("Can't map " + path);
+        }
+    }
+
+    close(fd);
+}
+
+inline MappedFile::~MappedFile() {
+    if (address)
+        munmap(address, length);
+}
+
+inline MappedFile::MappedFile(MappedFile&& other) noexcept:
+        address(std::exchange(other.address, nullptr)), length(std::exchange(other.length, 0)) {
+
+}
+
+inline MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        if (address)
+            munmap(address, length);
+
+        address = std::exchange(other.address, nullptr);
+        length = std::exchange(other.length, 0);
+    }
+
+    return *this;
+}
+
+#endif //MCTS_MAPPEDFILE_H
@@ -0,0 +1,90 @@
+#ifndef MCTS_OPENINGBOOK_H
+#define MCTS_OPENINGBOOK_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+#include "MappedFile.h"
+
+// Best moves of positions searched offline, keyed by canonical information sets. The file is a header
+// followed by the entries sorted by key, it is memory-mapped, so opening a book of any size is instant
+// and the pages are shared between the processes using it
+class OpeningBook {
+public:
+    struct Entry {
+        uint64_t key; // InformationSet::canonicalKey()
+        uint64_t move; // InformationSet::canonicalMove()
+        uint32_t visits; // of the move in the search which has chosen it
+        uint32_t total; // of the root of that search
+    };
+
+    OpeningBook() = default; // an empty book
+    explicit OpeningBook(const std::string& path);
+
+    const Entry* find(uint64_t key) const; // nullptr if the position isn't in the book
+    size_t size() const { return count; }
+
+    // writes the entries sorted by key, of the entries with the same key the one with the most total visits is kept
+    static void write(const std::string& path, std::vector<Entry> entries);
+
+private:
+    struct Header {
+        char magic[8];
+        uint64_t count;
+    };
+
+    static constexpr char magic[8] = {'M', 'C', 'T', 'S', 'B', 'O', 'O', 'K'};
+
+    MappedFile file;
+    const Entry* entries = nullptr;
+    size_t count = 0;
+};
+
+inline OpeningBook::OpeningBook(const std::string& path): file(path) {
+    if (file.size() < sizeof(Header))
+        throw std::runtime_error("Bad opening book " + path + ": no header");
+
+    const Header* header = reinterpret_cast<const Header*>(file.data());
+
+    if (std::memcmp(header->magic, magic, sizeof(magic)) != 0 ||
+        file.size() != sizeof(Header) + header->count * sizeof(Entry))
+        throw std::runtime_error("Bad opening book " + path + ": wrong magic or size");
+
+    count = header->count;
+    entries = reinterpret_cast<const Entry*>(header + 1);
+}
+
+inline const OpeningBook::Entry* OpeningBook::find(uint64_t key) const {
+    const Entry* it = std::lower_bound(entries, entries + count, key, [](const Entry& e, uint64_t key) {
+        return e.key < key;
+    });
+
+    return it != entries + count && it->key == key ? it : nullptr;
+}
+
+inline void OpeningBook::write(const std::string& path, std::vector<Entry> entries) {
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+        return a.key < b.key || (a.key == b.key && a.total > b.total);
+    });
+
+    entries.erase(std::unique(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+        return a.key == b.key;
+    }), entries.end());
+
+    Header header{};
+    std::memcpy(header.magic, magic, sizeof(magic));
+    header.count = entries.size();
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(Entry));
+
+    if (!out)
+        throw std::runtime_error("Can't write opening book " + path);
+}
+
+#endif //MCTS_OPENINGBOOK_H
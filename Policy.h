@@ -0,0 +1,166 @@
+#ifndef MCTS_POLICY_H
+#define MCTS_POLICY_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+#include <random>
+#include <algorithm>
+
+// Selection policies of MCTS. A policy picks one of the children legal in the current determinization:
+//   struct Stats - what the policy keeps for every node besides visits and wins, the tree stores it
+//                  beside the nodes and doesn't allocate it at all when it's empty
+//   Policy(double parameter) - the parameter is the one passed to MCTS as exploration
+//   size_t select(const std::vector<Arm<Stats>>& arms, std::mt19937& rng) const - an index in arms
+//   void update(Stats& stats, double result) const - called in the backpropagation of the child's node
+//   static constexpr bool usesPriors - whether the score reads Arm::prior. Then, given an agent with priors,
+//                  a node gets all its moves as children the first time it's reached, each with its prior, and
+//                  select sees the unvisited ones too, with visits 0 and the mean value of the visited siblings
+
+// what a policy sees of a child
+template<typename Stats>
+struct Arm {
+    double value; // the mean result for the player making the move, blended with the AMAF value under RAVE
+    float wins;
+    uint32_t visits;
+    uint32_t avails; // how many times the move was legal when its parent was selected from
+    double prior; // the probability of the move before the search, uniform when there are no priors
+    Stats* stats;
+};
+
+// wins / visits + c * sqrt(ln(avails) / visits), the availability counts make it the ISMCTS variant
+struct UCB1 {
+    struct Stats {};
+    static constexpr bool usesPriors = false;
+
+    double exploration;
+
+    explicit UCB1(double exploration = 0.7): exploration(exploration) {}
+
+    double score(const Arm<Stats>& arm) const {
+        return arm.value + exploration * std::sqrt(std::log(arm.avails) / arm.visits);
+    }
+
+    size_t select(const std::vector<Arm<Stats>>& arms, std::mt19937&) const;
+    void update(Stats&, double) const {}
+};
+
+// UCB1 with the exploration scaled by the variance of the results, min(1/4, variance + its confidence bound)
+struct UCB1Tuned {
+    struct Stats {
+        float squares = 0; // the sum of the squared results
+    };
+    static constexpr bool usesPriors = false;
+
+    double exploration;
+
+    explicit UCB1Tuned(double exploration = 1.0): exploration(exploration) {}
+
+    double score(const Arm<Stats>& arm) const {
+        double log = std::log(arm.avails);
+        double mean = arm.wins / arm.visits;
+        double variance = arm.stats->squares / arm.visits - mean * mean + std::sqrt(2 * log / arm.visits);
+
+        return arm.value + exploration * std::sqrt(log / arm.visits * std::min(0.25, variance));
+    }
+
+    size_t select(const std::vector<Arm<Stats>>& arms, std::mt19937&) const;
+    void update(Stats& stats, double result) const { stats.squares += result * result; }
+};
+
+// the AlphaZero rule value + c * prior * sqrt(avails) / (1 + visits), it trusts the priors early
+// and the results later
+struct PUCT {
+    struct Stats {};
+    static constexpr bool usesPriors = true;
+
+    double exploration;
+
+    explicit PUCT(double exploration = 1.5): exploration(exploration) {}
+
+    double score(const Arm<Stats>& arm) const {
+        return arm.value + exploration * arm.prior * std::sqrt(static_cast<double>(arm.avails)) / (1 + arm.visits);
+    }
+
+    size_t select(const std::vector<Arm<Stats>>& arms, std::mt19937&) const;
+    void update(Stats&, double) const {}
+};
+
+// The adversarial bandit: a child is sampled with probability (1 - gamma) * softmax(eta * gain) + gamma / K,
+// eta = gamma / K, where gain sums the results divided by the probabilities they were sampled with.
+// It doesn't assume the results of a child are stationary, so it suits the nodes where the players
+// effectively move at the same time, not seeing the cards of each other
+struct EXP3 {
+    struct Stats {
+        float gain = 0;
+        float probability = 1; // of the last selection, a new node is reached without one
+    };
+    static constexpr bool usesPriors = false;
+
+    double gamma;
+
+    explicit EXP3(double gamma = 0.1): gamma(gamma) {}
+
+    size_t select(const std::vector<Arm<Stats>>& arms, std::mt19937& rng) const;
+    void update(Stats& stats, double result) const { stats.gain += result / stats.probability; }
+
+private:
+    mutable std::vector<double> weights;
+};
+
+template<typename Policy>
+size_t argmax(const Policy& policy, const std::vector<Arm<typename Policy::Stats>>& arms) {
+    size_t best = 0;
+    double max = policy.score(arms[0]);
+
+    for (size_t i = 1; i < arms.size(); ++i) {
+        double score = policy.score(arms[i]);
+
+        if (score > max) {
+            max = score;
+            best = i;
+        }
+    }
+
+    return best;
+}
+
+inline size_t UCB1::select(const std::vector<Arm<Stats>>& arms, std::mt19937&) const {
+    return argmax(*this, arms);
+}
+
+inline size_t UCB1Tuned::select(const std::vector<Arm<Stats>>& arms, std::mt19937&) const {
+    return argmax(*this, arms);
+}
+
+inline size_t PUCT::select(const std::vector<Arm<Stats>>& arms, std::mt19937&) const {
+    return argmax(*this, arms);
+}
+
+inline size_t EXP3::select(const std::vector<Arm<Stats>>& arms, std::mt19937& rng) const {
+    double eta = gamma / arms.size();
+    double max = arms[0].stats->gain;
+
+    for (const Arm<Stats>& arm : arms)
+        max = std::max<double>(max, arm.stats->gain);
+
+    // shifted by the largest gain, so that exp doesn't overflow
+    double sum = 0;
+    weights.clear();
+
+    for (const Arm<Stats>& arm : arms) {
+        weights.push_back(std::exp(eta * (arm.stats->gain - max)));
+        sum += weights.back();
+    }
+
+    for (double& weight : weights)
+        weight = (1 - gamma) * weight / sum + gamma / arms.size();
+
+    size_t chosen = std::discrete_distribution<size_t>(weights.begin(), weights.end())(rng);
+    arms[chosen].stats->probability = weights[chosen];
+
+    return chosen;
+}
+
+#endif //MCTS_POLICY_H
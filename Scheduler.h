@@ -0,0 +1,225 @@
+#ifndef MCTS_SCHEDULER_H
+#define MCTS_SCHEDULER_H
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <chrono>
+#include <algorithm>
+#include "StopToken.h"
+
+// Runs many independent searches on a fixed set of worker threads. A search is split into batches of
+// iterations, only one batch of a search runs at a time, so the search itself needn't be thread-safe.
+// The parallelism is across searches only: a single search runs on one worker at a time however many
+// there are, and the other workers idle unless they have searches of their own. MCTS isn't thread-safe,
+// running the batches of one search together would need a locked tree or root parallelism.
+// Every worker keeps its own deque of jobs ordered by deadline and takes the most urgent one,
+// an idle worker steals the most urgent job from the other deques
+class SearchScheduler {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit SearchScheduler(size_t threads = std::thread::hardware_concurrency(), size_t batch = 64);
+    ~SearchScheduler(); // finishes all the submitted jobs and joins the workers
+
+    SearchScheduler(const SearchScheduler&) = delete;
+    SearchScheduler& operator=(const SearchScheduler&) = delete;
+
+    // calls step(n) with n <= batch until iterations are made, deadline passes, stop is requested or step
+    // returns false, then calls done()
+    void search(std::function<bool(size_t)> step, size_t iterations, Clock::time_point deadline,
+                std::function<void()> done, StopToken stop = {});
+    void submit(std::function<void()> task); // runs task once, before any search
+
+private:
+    struct Job {
+        std::function<bool(size_t)> step;
+        size_t remaining;
+        Clock::time_point deadline;
+        std::function<void()> done;
+        StopToken stop;
+        bool started = false;
+    };
+
+    using JobPtr = std::shared_ptr<Job>;
+
+    struct Worker {
+        std::mutex mutex;
+        std::deque<JobPtr> jobs; // ordered by deadline
+    };
+
+    const size_t batch;
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+
+    std::mutex mutex; // guards the counters and stopping
+    std::condition_variable wake;
+    size_t alive = 0; // jobs which aren't done yet
+    size_t available = 0; // jobs waiting in the deques
+    size_t next = 0; // worker for the next job submitted from outside
+    bool stopping = false;
+
+    static inline thread_local int current = -1; // index of the worker running on this thread, -1 outside
+
+    void push(size_t worker, JobPtr job);
+    JobPtr pop(size_t worker);
+    JobPtr steal(size_t thief);
+    void work(size_t index);
+};
+
+inline SearchScheduler::SearchScheduler(size_t threads, size_t batch): batch(std::max<size_t>(batch, 1)) {
+    if (threads == 0)
+        threads = 1;
+
+    for (size_t i = 0; i < threads; ++i)
+        workers.push_back(std::make_unique<Worker>());
+
+    for (size_t i = 0; i < threads; ++i)
+        this->threads.emplace_back(&SearchScheduler::work, this, i);
+}
+
+inline SearchScheduler::~SearchScheduler() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+
+    wake.notify_all();
+
+    for (std::thread& thread : threads)
+        thread.join();
+}
+
+inline void SearchScheduler::search(std::function<bool(size_t)> step, size_t iterations, Clock::time_point deadline,
+                                    std::function<void()> done, StopToken stop) {
+    JobPtr job = std::make_shared<Job>();
+    job->step = std::move(step);
+    job->remaining = iterations;
+    job->deadline = deadline;
+    job->done = std::move(done);
+    job->stop = std::move(stop);
+
+    size_t worker;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        worker = current >= 0 ? current : next++ % workers.size();
+        ++alive;
+    }
+
+    push(worker, std::move(job));
+}
+
+inline void SearchScheduler::submit(std::function<void()> task) {
+    search([task = std::move(task)](size_t) { task(); return true; }, 1, Clock::time_point::min(), [] {});
+}
+
+inline void SearchScheduler::push(size_t worker, JobPtr job) {
+    {
+        Worker& w = *workers.at(worker);
+        std::lock_guard<std::mutex> lock(w.mutex);
+
+        auto it = std::upper_bound(w.jobs.begin(), w.jobs.end(), job, [](const JobPtr& a, const JobPtr& b) {
+            return a->deadline < b->deadline;
+        });
+
+        w.jobs.insert(it, std::move(job));
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++available;
+    }
+
+    wake.notify_one();
+}
+
+inline SearchScheduler::JobPtr SearchScheduler::pop(size_t worker) {
+    Worker& w = *workers.at(worker);
+    std::lock_guard<std::mutex> lock(w.mutex);
+
+    if (w.jobs.empty())
+        return nullptr;
+
+    JobPtr job = std::move(w.jobs.front());
+    w.jobs.pop_front();
+
+    std::lock_guard<std::mutex> counters(mutex);
+    --available;
+    return job;
+}
+
+inline SearchScheduler::JobPtr SearchScheduler::steal(size_t thief) {
+    // the victim is the worker with the most urgent job
+    size_t victim = thief;
+    Clock::time_point earliest = Clock::time_point::max();
+
+    for (size_t i = 0; i < workers.size(); ++i) {
+        if (i == thief)
+            continue;
+
+        Worker& w = *workers.at(i);
+        std::lock_guard<std::mutex> lock(w.mutex);
+
+        if (!w.jobs.empty() && (victim == thief || w.jobs.front()->deadline < earliest)) {
+            victim = i;
+            earliest = w.jobs.front()->deadline;
+        }
+    }
+
+    return victim == thief ? nullptr : pop(victim);
+}
+
+inline void SearchScheduler::work(size_t index) {
+    current = static_cast<int>(index);
+
+    while (true) {
+        JobPtr job = pop(index);
+
+        if (!job)
+            job = steal(index);
+
+        if (!job) {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] { return available > 0 || (stopping && alive == 0); });
+
+            if (available == 0)
+                return;
+
+            continue;
+        }
+
+        // the deadline may cut the search, but it makes at least one batch, a stop cuts it at once
+        if (job->stop.stopRequested() || (job->started && Clock::now() >= job->deadline))
+            job->remaining = 0;
+
+        if (job->remaining > 0) {
+            size_t n = std::min(batch, job->remaining);
+            job->remaining = job->step(n) ? job->remaining - n : 0;
+            job->started = true;
+        }
+
+        if (job->remaining > 0 && Clock::now() < job->deadline) {
+            push(index, std::move(job));
+            continue;
+        }
+
+        job->done();
+
+        bool finished;
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            finished = --alive == 0 && stopping;
+        }
+
+        if (finished)
+            wake.notify_all();
+    }
+}
+
+#endif //MCTS_SCHEDULER_H
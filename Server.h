@@ -0,0 +1,271 @@
+#ifndef MCTS_SERVER_H
+#define MCTS_SERVER_H
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <functional>
+#include "Durak.h"
+#include "DurakAgent.h"
+#include "EngineConfig.h"
+#include "MCTS.h"
+#include "Scheduler.h"
+
+// Long-running engine serving many games over a line protocol. Every command is one line, every answer is
+// one line starting with its kind and the game id. Answers to different games may come in any order,
+// commands for one game are executed in the order they were received:
+//   new <id> <state>       creates a game from DurakState::serialize()          -> ok <id>
+//   move <id> <move>       applies a move in the DurakState::stringToMove format -> ok <id>
+//   go <id> <iterations> [milliseconds]
+//                          searches for the player to move within the budget     -> bestmove <id> <move>
+//   stop <id>              cuts the searches of the game already received,
+//                          each answers with its best move so far                -> ok <id>
+//   state <id>                                                                   -> state <id> <state>
+//   save <id> <path>       writes a snapshot of the search tree                  -> ok <id>
+//   load <id> <path>       replaces the search tree with a snapshot taken
+//                          at the position of the game                           -> ok <id>
+//   delete <id>            stops the searches and forgets the game               -> ok <id>
+//   quit                   waits for all the commands to finish and stops
+// Failures are reported as "error <id> <message>". Every game is searched with the same settings and
+// rollout weights, the ones given to the server
+class DurakServer {
+public:
+    explicit DurakServer(size_t threads = std::thread::hardware_concurrency(),
+                         const EngineConfig& config = EngineConfig(),
+                         const DurakSoftmaxAgent::Weights& weights = DurakSoftmaxAgent::Weights{},
+                         std::shared_ptr<const OpeningBook> book = nullptr);
+
+    void run(std::istream& in, std::ostream& out);
+
+private:
+    struct Game {
+        const std::string id;
+        DurakState state;
+        MCTS<DurakState, DurakSoftmaxAgent> mcts;
+
+        std::mutex mutex; // guards pending and busy
+        std::queue<std::function<bool()>> pending; // a task returns false if it resumes the game itself later
+        bool busy = false;
+
+        StopSource stop; // of the searches received so far, accessed only by the thread reading commands
+
+        Game(std::string id, const DurakState& state, const DurakServer& server);
+    };
+
+    const EngineConfig config;
+    const DurakSoftmaxAgent::Weights weights;
+    const std::shared_ptr<const OpeningBook> book; // shared by all the games
+    std::map<std::string, std::shared_ptr<Game>> games; // accessed only by the thread reading commands
+    std::ostream* out = nullptr;
+    std::mutex outMutex;
+    SearchScheduler scheduler; // the last member, so that its destructor finishes the jobs while the rest is alive
+
+    void execute(const std::string& line);
+    void post(const std::shared_ptr<Game>& game, std::function<bool()> task); // runs tasks of a game one by one
+    void resume(const std::shared_ptr<Game>& game);
+    void drain(const std::shared_ptr<Game>& game);
+    void answer(const std::string& line);
+};
+
+inline DurakServer::Game::Game(std::string id, const DurakState& state, const DurakServer& server):
+        id(std::move(id)), state(state), mcts(server.config.exploration, state, DurakSoftmaxAgent(server.weights),
+                                              server.config.widening, server.config.wideningExponent) {
+    mcts.output = nullptr;
+    mcts.book = server.book;
+    mcts.rave = server.config.rave;
+}
+
+inline DurakServer::DurakServer(size_t threads, const EngineConfig& config, const DurakSoftmaxAgent::Weights& weights,
+                                std::shared_ptr<const OpeningBook> book):
+        config(config), weights(weights), book(std::move(book)), scheduler(threads) {
+
+}
+
+inline void DurakServer::run(std::istream& in, std::ostream& output) {
+    out = &output;
+
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line == "quit")
+            break;
+
+        if (!line.empty())
+            execute(line);
+    }
+}
+
+inline void DurakServer::execute(const std::string& line) {
+    std::istringstream command(line);
+    std::string kind, id;
+    command >> kind >> id;
+
+    std::string rest;
+    std::getline(command >> std::ws, rest);
+
+    if (id.empty()) {
+        answer("error - no game id in '" + line + "'");
+        return;
+    }
+
+    if (kind == "new") {
+        try {
+            games[id] = std::make_shared<Game>(id, DurakState::deserialize(rest), *this);
+            answer("ok " + id);
+        } catch (const std::exception& ex) {
+            answer("error " + id + " " + ex.what());
+        }
+
+        return;
+    }
+
+    auto it = games.find(id);
+
+    if (it == games.end()) {
+        answer("error " + id + " no such game");
+        return;
+    }
+
+    std::shared_ptr<Game> game = it->second;
+
+    if (kind == "move") {
+        post(game, [this, game, id, rest] {
+            DurakState::Move move = DurakState::stringToMove(rest);
+
+            game->state.makeMove(move);
+            game->mcts.makeMove(move, game->state.informationSet());
+            answer("ok " + id);
+
+            // the client is busy with the answer, there is time to gather the remaining tree
+            game->mcts.compact();
+            return true;
+        });
+    } else if (kind == "go") {
+        std::istringstream budget(rest);
+        size_t iters = 10'000;
+        long long milliseconds = -1;
+        budget >> iters >> milliseconds;
+
+        SearchScheduler::Clock::time_point deadline = milliseconds < 0 ? SearchScheduler::Clock::time_point::max() :
+                SearchScheduler::Clock::now() + std::chrono::milliseconds(milliseconds);
+
+        StopToken stop = game->stop.token();
+
+        post(game, [this, game, id, iters, deadline, stop] {
+            // a book move is answered at once, without a search
+            if (DurakState::Move move = game->mcts.bookMove(); !move.isNull()) {
+                answer("bestmove " + id + " " + DurakState::moveToString(move));
+                return true;
+            }
+
+            auto left = std::make_shared<size_t>(iters);
+            auto error = std::make_shared<std::optional<std::string>>(); // what the search failed with, if it did
+
+            auto step = [game, left, error](size_t n) {
+                try {
+                    game->mcts.loop(n);
+                    *left -= n;
+                    return !game->mcts.isDecided(*left);
+                } catch (const std::exception& ex) {
+                    *error = ex.what();
+                    return false;
+                }
+            };
+
+            scheduler.search(step, iters, deadline, [this, game, id, error] {
+                try {
+                    DurakState::Move move = *error ? DurakState::Move::null() : game->mcts.bestMove();
+
+                    if (*error)
+                        answer("error " + id + " " + **error);
+                    else if (move.isNull())
+                        answer("error " + id + " no moves");
+                    else
+                        answer("bestmove " + id + " " + DurakState::moveToString(move));
+                } catch (const std::exception& ex) {
+                    answer("error " + id + " " + ex.what());
+                }
+
+                resume(game);
+            }, stop);
+
+            return false;
+        });
+    } else if (kind == "state") {
+        post(game, [this, game, id] {
+            answer("state " + id + " " + game->state.serialize());
+            return true;
+        });
+    } else if (kind == "save" || kind == "load") {
+        post(game, [this, game, id, kind, rest] {
+            if (kind == "save")
+                game->mcts.snapshot(rest);
+            else
+                game->mcts.restore(rest, game->state.informationSet());
+
+            answer("ok " + id);
+            return true;
+        });
+    } else if (kind == "stop") {
+        game->stop.requestStop();
+        game->stop = StopSource();
+        answer("ok " + id);
+    } else if (kind == "delete") {
+        game->stop.requestStop();
+        games.erase(it);
+        answer("ok " + id);
+    } else {
+        answer("error " + id + " unknown command " + kind);
+    }
+}
+
+inline void DurakServer::post(const std::shared_ptr<Game>& game, std::function<bool()> task) {
+    std::lock_guard<std::mutex> lock(game->mutex);
+    game->pending.push(std::move(task));
+
+    if (game->busy)
+        return;
+
+    game->busy = true;
+    resume(game);
+}
+
+inline void DurakServer::resume(const std::shared_ptr<Game>& game) {
+    scheduler.submit([this, game] { drain(game); });
+}
+
+inline void DurakServer::drain(const std::shared_ptr<Game>& game) {
+    while (true) {
+        std::function<bool()> task;
+
+        {
+            std::lock_guard<std::mutex> lock(game->mutex);
+
+            if (game->pending.empty()) {
+                game->busy = false;
+                return;
+            }
+
+            task = std::move(game->pending.front());
+            game->pending.pop();
+        }
+
+        try {
+            if (!task())
+                return;
+        } catch (const std::exception& ex) {
+            answer("error " + game->id + " " + ex.what());
+        }
+    }
+}
+
+inline void DurakServer::answer(const std::string& line) {
+    std::lock_guard<std::mutex> lock(outMutex);
+    *out << line << std::endl;
+}
+
+#endif //MCTS_SERVER_H
@@ -0,0 +1,64 @@
+#ifndef MCTS_STOPTOKEN_H
+#define MCTS_STOPTOKEN_H
+
+#include <atomic>
+#include <memory>
+
+// Cooperative cancellation in the spirit of std::stop_source/std::stop_token, which C++17 lacks.
+// A source and all its tokens share one flag, a default constructed token can never be stopped
+class StopToken {
+public:
+    StopToken() = default;
+
+    bool stopRequested() const;
+    bool stopPossible() const;
+
+private:
+    friend class StopSource;
+
+    std::shared_ptr<const std::atomic<bool>> stopped;
+
+    explicit StopToken(std::shared_ptr<const std::atomic<bool>> stopped);
+};
+
+class StopSource {
+public:
+    StopSource();
+
+    StopToken token() const;
+    bool requestStop(); // returns false if the stop has already been requested
+    bool stopRequested() const;
+
+private:
+    std::shared_ptr<std::atomic<bool>> stopped;
+};
+
+inline StopToken::StopToken(std::shared_ptr<const std::atomic<bool>> stopped): stopped(std::move(stopped)) {
+
+}
+
+inline bool StopToken::stopRequested() const {
+    return stopped && stopped->load(std::memory_order_relaxed);
+}
+
+inline bool StopToken::stopPossible() const {
+    return static_cast<bool>(stopped);
+}
+
+inline StopSource::StopSource(): stopped(std::make_shared<std::atomic<bool>>(false)) {
+
+}
+
+inline StopToken StopSource::token() const {
+    return StopToken(stopped);
+}
+
+inline bool StopSource::requestStop() {
+    return !stopped->exchange(true);
+}
+
+inline bool StopSource::stopRequested() const {
+    return stopped->load(std::memory_order_relaxed);
+}
+
+#endif //MCTS_STOPTOKEN_H
@@ -0,0 +1,53 @@
+#ifndef MCTS_TIMEMANAGER_H
+#define MCTS_TIMEMANAGER_H
+
+#include <chrono>
+#include <algorithm>
+
+// Splits a game clock between the moves of one player. Every move gets a target time, which the search
+// may exceed up to a limit when its result is unstable, and the clock is charged with the time really spent
+class TimeManager {
+public:
+    using Clock = std::chrono::steady_clock;
+    using Duration = std::chrono::milliseconds;
+
+    struct Budget {
+        Duration target; // the search stops after it if the best move is settled
+        Duration limit; // the search never goes beyond it
+    };
+
+    explicit TimeManager(Duration total, Duration increment = Duration(0));
+
+    Duration remaining() const { return left; }
+
+    // expectedMoves is how many moves the player is likely to make till the end, criticality is how much
+    // more than usual the position deserves, 1 for an ordinary position
+    Budget budget(int expectedMoves, double criticality = 1.0) const;
+    void charge(Duration spent); // takes the time spent by a move and adds the increment
+
+private:
+    Duration left;
+    const Duration increment;
+};
+
+inline TimeManager::TimeManager(Duration total, Duration increment): left(total), increment(increment) {
+
+}
+
+inline TimeManager::Budget TimeManager::budget(int expectedMoves, double criticality) const {
+    // a reserve is kept, so that the last moves never run out of time
+    Duration usable = left - std::min(left, Duration(left.count() / 20));
+    double base = static_cast<double>(usable.count()) / std::max(expectedMoves, 1) + 0.8 * increment.count();
+
+    Duration limit(static_cast<long long>(std::min(3 * base * criticality, usable.count() / 3.0)));
+    Duration target(static_cast<long long>(base * criticality));
+
+    return {std::min(target, limit), limit};
+}
+
+inline void TimeManager::charge(Duration spent) {
+    left -= std::min(left, spent);
+    left += increment;
+}
+
+#endif //MCTS_TIMEMANAGER_H
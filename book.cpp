@@ -0,0 +1,94 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include "Durak.h"
+#include "MCTS.h"
+#include "OpeningBook.h"
+
+// Builds an opening book: plays games from fresh deals, searching the first plies deeply, and stores
+// the chosen moves keyed by the canonical information set of the player to move. The first game is
+// DurakState(), the other deals are DurakState(seed) with the seeds from 0 up, skipping the default one
+//   MCTSBook <output> [games] [plies] [iterations] [threads]
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <output> [games] [plies] [iterations] [threads]" << std::endl;
+        return 1;
+    }
+
+    std::string path = argv[1];
+    size_t games = argc > 2 ? std::stoul(argv[2]) : 64;
+    size_t plies = argc > 3 ? std::stoul(argv[3]) : 4;
+    size_t iterations = argc > 4 ? std::stoul(argv[4]) : 50'000;
+    size_t threads = argc > 5 ? std::stoul(argv[5]) : std::thread::hardware_concurrency();
+
+    std::unordered_map<uint64_t, OpeningBook::Entry> book;
+    std::mutex mutex; // guards book
+    std::atomic<size_t> next(0);
+
+    auto work = [&] {
+        for (size_t game = next++; game < games; game = next++) {
+            // the default deal comes once, first
+            size_t seed = game == 0 ? DurakState::defaultSeed : game - 1 + (game - 1 >= DurakState::defaultSeed);
+            DurakState state(seed);
+
+            for (size_t ply = 0; ply < plies && !state.isTerminal(); ++ply) {
+                DurakState::InformationSet info = state.informationSet();
+                uint64_t key = info.canonicalKey();
+                DurakState::Move move;
+
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    auto it = book.find(key);
+
+                    if (it != book.end())
+                        move = info.fromCanonicalMove(it->second.move);
+                }
+
+                if (move.isNull()) {
+                    MCTS<DurakState> mcts(0.7, info);
+                    mcts.output = nullptr;
+
+                    move = mcts.getMove(iterations);
+
+                    auto progress = mcts.progress();
+                    size_t visits = 0;
+
+                    for (const auto& child : progress.children)
+                        if (child.move == move)
+                            visits = child.visits;
+
+                    std::lock_guard<std::mutex> lock(mutex);
+                    book[key] = {key, info.canonicalMove(move), static_cast<uint32_t>(visits),
+                                 static_cast<uint32_t>(progress.visits)};
+                }
+
+                state.makeMove(move);
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            std::cerr << "Game " << game + 1 << "/" << games << " done, " << book.size() << " positions" << std::endl;
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < std::max<size_t>(threads, 1); ++i)
+        workers.emplace_back(work);
+
+    for (std::thread& worker : workers)
+        worker.join();
+
+    std::vector<OpeningBook::Entry> entries;
+    entries.reserve(book.size());
+
+    for (const auto& [key, entry] : book)
+        entries.push_back(entry);
+
+    OpeningBook::write(path, entries);
+    std::cout << "Wrote " << entries.size() << " positions to " << path << std::endl;
+
+    return 0;
+}
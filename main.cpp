@@ -1,6 +1,9 @@
 #include <iostream>
 #include "Durak.h"
 #include "MCTS.h"
+#include "DurakAgent.h"
+#include "EngineConfig.h"
+#include "Server.h"
 #include <ctime>
 #include <chrono>
 
@@ -10,11 +13,6 @@ using std::cin;
 
 using State = DurakState;
 using Move = State::Move;
-using MovePtr = State::MovePtr;
-
-using AttackMove = State::AttackMove;
-using DefendMove = State::DefendMove;
-using ThrowInMove = State::ThrowInMove;
 using Card = State::Card;
 
 /*std::tuple<int, int, int, double, double> tournament(State::Move (*g)(const State&)) {
@@ -87,23 +85,55 @@ State::Move bestMove(const State& s) {
     return move;
 }*/
 
-int main() {
+int main(int argc, char** argv) {
+    // the options go before --server: --book <path> loads an opening book built by MCTSBook,
+    // --clock <seconds> gives the engine a game clock instead of a fixed number of iterations per move,
+    // --rave <k> turns on RAVE with the equivalence parameter k, --weights <path> loads the weights of the
+    // rollout policy trained by MCTSTrain, without them the rollouts are random, --config <path> loads
+    // the search settings tuned by MCTSTune, the options after it override them. All but --clock apply
+    // to the server as well, it takes the budget of every search from the go command
+    std::shared_ptr<const OpeningBook> book;
+    std::unique_ptr<TimeManager> clock;
+    EngineConfig config;
+    DurakSoftmaxAgent::Weights weights{};
+
+    while (argc > 2 && (std::string(argv[1]) == "--book" || std::string(argv[1]) == "--clock" ||
+                        std::string(argv[1]) == "--rave" || std::string(argv[1]) == "--weights" ||
+                        std::string(argv[1]) == "--config")) {
+        if (std::string(argv[1]) == "--book")
+            book = std::make_shared<const OpeningBook>(argv[2]);
+        else if (std::string(argv[1]) == "--rave")
+            config.rave = std::stod(argv[2]);
+        else if (std::string(argv[1]) == "--config")
+            config = EngineConfig::load(argv[2]);
+        else if (std::string(argv[1]) == "--weights")
+            weights = DurakSoftmaxAgent::load(argv[2]);
+        else
+            clock = std::make_unique<TimeManager>(std::chrono::milliseconds(std::stoll(argv[2]) * 1000));
+
+        argc -= 2;
+        argv += 2;
+    }
+
+    if (argc > 1 && std::string(argv[1]) == "--server") {
+        size_t threads = argc > 2 ? std::stoul(argv[2]) : std::thread::hardware_concurrency();
+        DurakServer(threads, config, weights, book).run(std::cin, std::cout);
+        return 0;
+    }
+
     // srand(time(nullptr));
     srand(5);
 
     /*State s;
 
-    std::shared_ptr<DurakState::AttackMove> move = std::make_shared<DurakState::AttackMove>();
-    move->cards.push_back(s.getHands().front().front());
-
-    s.makeMove(move);*/
+    s.makeMove(Move(DurakState::Attack, 1ull << s.getHands().front().front().n));*/
 
     /*State s;
     std::cout << s.toString();
 
     MCTS<State> mcts;
-    MovePtr move = mcts.getMove();
-    std::cout << static_cast<std::string>(*move) << std::endl;*/
+    Move move = mcts.getMove();
+    std::cout << static_cast<std::string>(move) << std::endl;*/
 
     /*auto [f, d, s, t1, t2] = tournament(&bestMove);
     int total = f + d + s;
@@ -115,11 +145,11 @@ int main() {
     printf("Minimax took %.2fs\n", t2);*/
 
     std::vector<Card> deck;
-    std::vector<std::vector<Card>> hands =
-            {{Card("KS", false), Card("QS", false), Card("JS", false),
+    State::Hands hands =
+            {std::vector<Card>{Card("KS", false), Card("QS", false), Card("JS", false),
                      Card("10S", false), Card("9S", false), Card("8S", false),
                      Card("7S", false), Card("6S", false)},
-             {Card("AS", false), Card("AC", false), Card("AH", false),
+             std::vector<Card>{Card("AS", false), Card("AC", false), Card("AH", false),
                      Card("AD", false)}};
     std::vector<Card> attack;
     std::vector<std::pair<Card, Card>> defended;
@@ -131,13 +161,16 @@ int main() {
     int playerToMove = 1;
 
     State s(deck, hands, attack, defended, discard, trump, defending, defendingPlayer, attackingPlayer, playerToMove);
-    MCTS<State> mcts(0.7, s);
+    MCTS<State, DurakSoftmaxAgent> mcts(config.exploration, s, DurakSoftmaxAgent(weights), config.widening,
+                                        config.wideningExponent);
+    mcts.book = book;
+    mcts.rave = config.rave;
 
     /*std::cout << std::endl << "Initial state:" << std::endl << s.toString() << std::endl << std::endl;
 
-    MovePtr move = mcts.getMove();
+    Move move = mcts.getMove();
 
-    std::cout << "The MCTS made the following move:" << std::endl << static_cast<std::string>(*move)
+    std::cout << "The MCTS made the following move:" << std::endl << static_cast<std::string>(move)
               << std::endl << std::endl;
 
     s.makeMove(move);
@@ -146,6 +179,7 @@ int main() {
     std::cout << std::endl << "State after the move:" << std::endl << s.toString() << std::endl << std::endl;*/
 
     int player = 2;
+    int engine = (player % s.numberOfPlayers) + 1;
 
     std::cout << std::endl << "Initial state:" << std::endl << s.toString() << std::endl << std::endl;
 
@@ -156,20 +190,21 @@ int main() {
 
             std::string str;
             getline(cin, str);
-            MovePtr move = DurakState::stringToMove(str);
+            Move move = DurakState::stringToMove(str);
 
             s.makeMove(move);
-            mcts.makeMove(move);
+            mcts.makeMove(move, s.informationSet(engine));
 
             std::cout << std::endl << "State after your move:" << std::endl << s.toString() << std::endl << std::endl;
         } else {
-            MovePtr move = mcts.getMove();
+            Move move = clock ? mcts.getMove(*clock) : mcts.getMove();
 
-            std::cout << "The MCTS made the following move:" << std::endl << static_cast<std::string>(*move)
+            std::cout << "The MCTS made the following move:" << std::endl << static_cast<std::string>(move)
                       << std::endl << std::endl;
 
             s.makeMove(move);
-            mcts.makeMove(move);
+            mcts.makeMove(move, s.informationSet(engine));
+            mcts.compact(); // while the player thinks
         }
     }
 
@@ -0,0 +1,100 @@
+#include <iostream>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include "tictactoe.h"
+#include "MCTS.h"
+
+using Engine = MCTS<ttt::State>;
+using Clock = std::chrono::steady_clock;
+
+// the number of iterations after which the best move of a fresh search from state stays optimal up to
+// limit, or limit + 1 if it's still wrong at limit. The engines are seeded the same way, so the counts
+// don't depend on the threads
+size_t convergence(const ttt::Oracle& oracle, const ttt::State& state, size_t limit) {
+    Engine engine(0.7, state);
+    engine.output = nullptr;
+    size_t last = 0; // the last iteration with a wrong best move
+
+    for (size_t i = 1; i <= limit; ++i) {
+        engine.iterate();
+
+        if (!oracle.isOptimal(state, engine.bestMove()))
+            last = i;
+    }
+
+    return last + 1;
+}
+
+// Measures how fast MCTS finds the perfect-play moves of tic-tac-toe: every reachable position with a
+// losing or drawing move is searched from scratch, and the iterations needed to settle on an optimal move
+// are compared with the solved game. The iteration counts are exact and repeatable, so a change meant only
+// to speed the search up must keep them, the wall time is measured for every thread count
+//   MCTSOracle [iteration limit] [thread counts, e.g. 1,2,4]
+int main(int argc, char** argv) {
+    size_t limit = argc > 1 ? std::stoul(argv[1]) : 2'000;
+    std::vector<size_t> threadCounts;
+
+    std::istringstream list(argc > 2 ? argv[2] : std::to_string(std::thread::hardware_concurrency()));
+    for (std::string count; std::getline(list, count, ',');)
+        threadCounts.push_back(std::max<size_t>(std::stoul(count), 1));
+
+    Clock::time_point start = Clock::now();
+    ttt::Oracle oracle;
+    std::vector<ttt::State> positions;
+
+    for (const ttt::State& state : oracle.positions()) {
+        uint legal = 0;
+        for (ttt::State::Move move : state.getMoves())
+            legal |= 1u << move;
+
+        if (oracle.optimalMoves(state) != legal)
+            positions.push_back(state);
+    }
+
+    std::cout << "Solved " << oracle.positions().size() << " positions in "
+              << std::chrono::duration<double, std::milli>(Clock::now() - start).count() << " ms, the empty board is "
+              << oracle.value(ttt::State()) << ", " << positions.size() << " positions have a wrong move" << std::endl;
+
+    for (size_t threads : threadCounts) {
+        std::vector<size_t> iterations(positions.size());
+        std::atomic<size_t> next(0);
+
+        auto work = [&] {
+            for (size_t i = next++; i < positions.size(); i = next++)
+                iterations[i] = convergence(oracle, positions[i], limit);
+        };
+
+        start = Clock::now();
+        std::vector<std::thread> workers;
+
+        for (size_t i = 0; i < threads; ++i)
+            workers.emplace_back(work);
+
+        for (std::thread& worker : workers)
+            worker.join();
+
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+        size_t total = 0, failed = 0;
+        for (size_t n : iterations) {
+            total += std::min(n, limit);
+            failed += n > limit;
+        }
+
+        std::sort(iterations.begin(), iterations.end());
+        auto percentile = [&iterations](double p) { return iterations[(iterations.size() - 1) * p]; };
+
+        std::cout << threads << " threads: " << seconds << " s, " << positions.size() * limit / seconds
+                  << " iterations/s; to an optimal move: total " << total << ", mean "
+                  << static_cast<double>(total) / positions.size() << ", median " << percentile(0.5) << ", 90% "
+                  << percentile(0.9) << ", max " << std::min(iterations.back(), limit) << ", " << failed
+                  << " not found in " << limit << std::endl;
+    }
+
+    return 0;
+}
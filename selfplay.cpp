@@ -0,0 +1,95 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include "Durak.h"
+#include "MCTS.h"
+#include "GameRecord.h"
+
+// Plays MCTS against MCTS from the deals DurakState(seed), seed = game number, and appends every game
+// with the statistics of each search to a record file. The engines may get different iteration budgets,
+// so the runner is also a tournament between them
+//   MCTSSelfPlay <output> [games] [iterations of player 1] [iterations of player 2] [threads]
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <output> [games] [iterations 1] [iterations 2] [threads]" << std::endl;
+        return 1;
+    }
+
+    std::string path = argv[1];
+    size_t games = argc > 2 ? std::stoul(argv[2]) : 100;
+    size_t iterations[2];
+    iterations[0] = argc > 3 ? std::stoul(argv[3]) : 1'000;
+    iterations[1] = argc > 4 ? std::stoul(argv[4]) : iterations[0];
+    size_t threads = argc > 5 ? std::stoul(argv[5]) : std::thread::hardware_concurrency();
+
+    GameRecordWriter writer(path);
+    std::mutex mutex; // guards writer and wins
+    size_t wins[3] = {0, 0, 0}; // unfinished, player 1, player 2
+    std::atomic<size_t> next(0);
+
+    auto work = [&] {
+        for (size_t game = next++; game < games; game = next++) {
+            DurakState state(game);
+            GameRecord record(state);
+
+            std::vector<MCTS<DurakState>> engines;
+            for (int player = 1; player <= state.numberOfPlayers; ++player) {
+                engines.emplace_back(0.7, state.informationSet(player));
+                engines.back().output = nullptr;
+            }
+
+            while (!state.isTerminal()) {
+                int player = state.playerToMove;
+                MCTS<DurakState>& engine = engines.at(player - 1);
+                DurakState::Move move = engine.getMove(iterations[player - 1]);
+
+                GameRecord::MoveStats stats;
+                stats.move = DurakState::recordMove(move);
+                stats.player = player;
+
+                auto progress = engine.progress();
+                stats.total = progress.visits;
+
+                for (const auto& child : progress.children)
+                    if (child.move == move) {
+                        stats.visits = child.visits;
+                        stats.value = child.visits ? child.wins / child.visits : 0;
+                    }
+
+                record.moves.push_back(stats);
+                state.makeMove(move);
+
+                for (int observer = 1; observer <= state.numberOfPlayers; ++observer) {
+                    engines.at(observer - 1).makeMove(move, state.informationSet(observer));
+                    engines.at(observer - 1).compact();
+                }
+            }
+
+            for (int player = 1; player <= state.numberOfPlayers; ++player)
+                if (state.getResult(player) == 1)
+                    record.winner = player;
+
+            std::lock_guard<std::mutex> lock(mutex);
+            writer.write(record);
+            ++wins[record.winner];
+
+            std::cerr << "Game " << game + 1 << "/" << games << ": " << record.moves.size() << " moves, "
+                      << (record.winner ? "player " + std::to_string(record.winner) + " won" : "draw") << std::endl;
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < std::max<size_t>(threads, 1); ++i)
+        workers.emplace_back(work);
+
+    for (std::thread& worker : workers)
+        worker.join();
+
+    std::cout << "Player 1 (" << iterations[0] << " iterations) won " << wins[1] << ", player 2 ("
+              << iterations[1] << " iterations) won " << wins[2] << ", draws " << wins[0] << std::endl;
+
+    return 0;
+}
@@ -1,4 +1,49 @@
 #include "tictactoe.h"
+#include <array>
+#include <cstdint>
+
+namespace {
+    constexpr uint board = 0b111111111u;
+
+    // whether a 9-bit board contains a full line, for every board
+    constexpr std::array<bool, 512> makeWins() {
+        constexpr uint lines[] = {0b111000000u, 0b000111000u, 0b000000111u,
+                                  0b100100100u, 0b010010010u, 0b001001001u,
+                                  0b100010001u, 0b001010100u};
+        std::array<bool, 512> wins{};
+
+        for (uint cells = 0; cells < 512; ++cells)
+            for (uint line : lines)
+                if ((cells & line) == line)
+                    wins[cells] = true;
+
+        return wins;
+    }
+
+    // the empty cells of an occupied board in ascending order
+    struct MoveList {
+        uint8_t size;
+        uint8_t cells[9];
+    };
+
+    constexpr std::array<MoveList, 512> makeMoveLists() {
+        std::array<MoveList, 512> lists{};
+
+        for (uint occupied = 0; occupied < 512; ++occupied)
+            for (uint cell = 0; cell < 9; ++cell)
+                if (!(occupied & (1u << cell)))
+                    lists[occupied].cells[lists[occupied].size++] = cell;
+
+        return lists;
+    }
+
+    constexpr std::array<bool, 512> wins = makeWins();
+    constexpr std::array<MoveList, 512> moveLists = makeMoveLists();
+
+    static_assert(wins[0b111000000u] && wins[0b100010001u] && !wins[0b110001000u], "wrong win table");
+    static_assert(moveLists[0].size == 9 && moveLists[board].size == 0 && moveLists[0b011111111u].cells[0] == 8,
+                  "wrong move lists");
+}
 
 ttt::State::State(uint player, uint opponent): player(player), opponent(opponent), occupied(player | opponent) {
     if ((player & opponent) || (player & ~0b111111111u) || (opponent & ~0b111111111u)) {
@@ -17,6 +62,10 @@ void ttt::State::makeMove(Move move) {
     if (!checkMove(move))
         throw std::runtime_error("Wrong move");
 
+    makeMoveUnchecked(move);
+}
+
+void ttt::State::makeMoveUnchecked(Move move) {
     occupied |= 1u << move;
     player |= 1u << move;
 
@@ -56,26 +105,21 @@ void ttt::State::checkTerminal() {
 }
 
 bool ttt::State::checkWin(uint state) {
-    std::vector<uint> masks = {0b111000000u, 0b000111000u, 0b000000111u,
-                               0b100100100u, 0b010010010u, 0b001001001u,
-                               0b100010001u, 0b001010100u};
-
-    return std::any_of(masks.begin(), masks.end(),
-                       [state](uint mask) { return (mask & state) == mask; });
+    return wins[state & board];
 }
 
 std::vector<std::pair<ttt::State, ttt::State::Move>> ttt::State::getMovesAndStates() const {
     if (terminal)
         return std::vector<std::pair<State, Move>>();
 
+    const MoveList& list = moveLists[occupied];
     std::vector<std::pair<State, Move>> moves;
+    moves.reserve(list.size);
 
-    for (uint move = 0; move < 9; ++move) {
-        if (!(occupied & (1u << move))) {
-            State new_state(*this);
-            new_state.makeMove(move);
-            moves.emplace_back(new_state, move);
-        }
+    for (uint i = 0; i < list.size; ++i) {
+        State new_state(*this);
+        new_state.makeMoveUnchecked(list.cells[i]);
+        moves.emplace_back(new_state, list.cells[i]);
     }
 
     return moves;
@@ -85,15 +129,8 @@ std::vector<ttt::State::Move> ttt::State::getMoves() const {
     if (terminal)
         return std::vector<Move>();
 
-    std::vector<Move> moves;
-
-    for (uint move = 0; move < 9; ++move) {
-        if (!(occupied & (1u << move))) {
-            moves.emplace_back(move);
-        }
-    }
-
-    return moves;
+    const MoveList& list = moveLists[occupied];
+    return std::vector<Move>(list.cells, list.cells + list.size);
 }
 
 ttt::State& ttt::State::operator=(const State& other) {
@@ -158,6 +195,139 @@ double ttt::State::getScore(int p) const {
 }
 
 ttt::State::Move ttt::State::randomMove() const {
-    std::vector<Move> moves = getMoves();
-    return moves[rand() % moves.size()];
+    const MoveList& list = moveLists[occupied];
+
+    if (terminal || !list.size)
+        return Move::null();
+
+    return list.cells[rng() % list.size];
+}
+
+ttt::State::MoveGenerator::MoveGenerator(const State& state, std::minstd_rand* shuffle):
+        left(state.terminal ? 0 : ~state.occupied & 0b111111111u), count(__builtin_popcount(left)), shuffle(shuffle) {
+
+}
+
+bool ttt::State::MoveGenerator::next(Move& move) {
+    if (!left)
+        return false;
+
+    uint cell = 0;
+
+    if (shuffle) {
+        // the cells left are the empty cells of the board where they are occupied
+        const MoveList& list = moveLists[~left & board];
+        cell = list.cells[(*shuffle)() % list.size];
+    } else {
+        cell = __builtin_ctz(left);
+    }
+
+    left &= ~(1u << cell);
+    move = Move(static_cast<int>(cell));
+    return true;
+}
+
+ttt::State::MoveGenerator ttt::State::moveGenerator() const {
+    return MoveGenerator(*this);
+}
+
+ttt::State::MoveGenerator ttt::State::randomMoveGenerator() const {
+    return MoveGenerator(*this, &rng);
+}
+
+double ttt::State::getResult(int p) const {
+    // score is for the player to move
+    int result = playerToMove == p ? score : -score;
+    return (result + 1) / 2.0;
+}
+
+ttt::State::InformationSet ttt::State::informationSet() const {
+    return InformationSet(*this, playerToMove);
+}
+
+ttt::State::InformationSet ttt::State::informationSet(int observer) const {
+    return InformationSet(*this, observer);
+}
+
+ttt::State::InformationSet::InformationSet(const State& state, int observer):
+        observer(observer), playerToMove(state.playerToMove), state(state) {
+
+}
+
+ttt::State ttt::State::InformationSet::sample(std::mt19937& rng) const {
+    State state;
+    sample(state, rng);
+    return state;
+}
+
+void ttt::State::InformationSet::sample(State& state, std::mt19937& rng) const {
+    state = this->state;
+    state.rng.seed(rng());
+}
+
+void ttt::State::InformationSet::makeMove(const Move& move) {
+    state.makeMove(move);
+    playerToMove = state.playerToMove;
+}
+
+ttt::State::Move ttt::State::InformationSet::fromCanonicalMove(uint64_t packed) const {
+    return packed < 9 && state.isLegal(static_cast<int>(packed)) ? Move(static_cast<int>(packed)) : Move::null();
+}
+
+int ttt::State::InformationSet::expectedMoves() const {
+    return (__builtin_popcount(~state.occupied & board) + 1) / 2;
+}
+
+ttt::Oracle::Oracle(): table(1u << 18) {
+    solve(State());
+}
+
+int ttt::Oracle::solve(const State& state) {
+    Entry& entry = table[state.key()];
+
+    if (entry.value != 2)
+        return entry.value;
+
+    if (state.isTerminal()) {
+        entry.value = state.getScore();
+        return entry.value;
+    }
+
+    reachable.push_back(state);
+    int best = -1;
+    uint optimal = 0;
+
+    for (const auto& [next, move] : state.getMovesAndStates()) {
+        int value = -solve(next);
+
+        if (value > best) {
+            best = value;
+            optimal = 0;
+        }
+
+        if (value == best)
+            optimal |= 1u << move;
+    }
+
+    entry.value = best;
+    entry.optimal = optimal;
+    return best;
+}
+
+int ttt::Oracle::value(const State& state) const {
+    const Entry& entry = table.at(state.key());
+
+    if (entry.value == 2)
+        throw std::runtime_error("Position isn't reachable:\n" + state.print());
+
+    return entry.value;
+}
+
+uint ttt::Oracle::optimalMoves(const State& state) const {
+    value(state);
+    return table[state.key()].optimal;
+}
+
+bool ttt::Oracle::isOptimal(const State& state, State::Move move) const {
+    return !move.isNull() && (optimalMoves(state) & (1u << move.m));
 }
@@ -5,6 +5,10 @@
 #include <vector>
 #include <stdexcept>
 #include <algorithm>
+#include <random>
+#include <cstdint>
+#include <cstddef>
+#include "GameState.h"
 
 typedef unsigned int uint;
 
@@ -16,6 +20,9 @@ namespace ttt {
         uint occupied = 0;
         bool terminal = false;
         int score = 0;
+        // of randomMove, not a part of the position: copies start from the default seed and assignment keeps
+        // it. InformationSet::sample reseeds it, so that the playouts of a search follow the search's rng
+        mutable std::minstd_rand rng;
 
         State(uint player, uint opponent, uint occupied, bool terminal, int score, int turn);
 
@@ -25,18 +32,11 @@ namespace ttt {
 
     public:
         struct Move {
-            int m;
+            int m = -1; // the null move by default
 
-            Move(int i): m(i) {}
-
-            Move(const Move& other): m(other.m) {}
-
-            Move(const Move&& other): m(other.m) {}
+            Move() = default;
 
-            Move& operator=(const Move& other) {
-                m = other.m;
-                return *this;
-            }
+            Move(int i): m(i) {}
 
             operator int() const { return m; }
 
@@ -45,9 +45,29 @@ namespace ttt {
             static Move null() { return Move(-1); }
 
             bool isNull() const { return (m == -1); }
+
+            explicit operator std::string() const { return isNull() ? "null" : std::to_string(m); }
         };
 
-        const int numberOfPlayers = 2;
+        using MoveRecord = Move;
+
+        class InformationSet;
+
+        // Yields the empty cells one by one, in ascending order or in random order drawn from shuffle
+        class MoveGenerator {
+        public:
+            explicit MoveGenerator(const State& state, std::minstd_rand* shuffle = nullptr);
+
+            bool next(Move& move); // writes the next move to 'move', returns false if there are no more moves
+            size_t size() const { return count; } // number of moves in all, including the yielded ones
+
+        private:
+            uint left; // cells which haven't been yielded yet
+            size_t count;
+            std::minstd_rand* shuffle;
+        };
+
+        static constexpr int numberOfPlayers = 2;
         int playerToMove = 1;
 
         State() = default;
@@ -58,18 +78,79 @@ namespace ttt {
 
         std::vector<std::pair<State, Move>> getMovesAndStates() const; // returns vector of pairs {new_state, move_to_this_state}
         std::vector<Move> getMoves() const; // returns vector of legal moves
+        MoveGenerator moveGenerator() const;
+        MoveGenerator randomMoveGenerator() const;
         bool isTerminal() const; // returns whether the node is terminal
         int getScore() const; // returns score of ended game; -1 - opponent wins, 0 - draw, 1 - player wins.
         // If the game isn't ended, the behaviour is undefined
         double getScore(int p) const;
+        double getResult(int p) const; // 1 if p has won, 0 if p has lost, 0.5 for a draw
+        bool isLegal(Move move) const { return !terminal && checkMove(move); }
         void makeMove(Move move); // move: int from 0 to 8
+        void makeMoveUnchecked(Move move); // the same without checkMove, for the moves from getMoves
         bool checkMove(Move move) const; // return whether the move is correct
         Move randomMove() const;
 
         std::string print() const;
+        uint key() const { return player | opponent << 9; } // unique for every position, below 2^18
+
+        InformationSet informationSet() const;
+        InformationSet informationSet(int observer) const;
+
+        static MoveRecord recordMove(const Move& move) { return move; }
+        static Move restoreMove(const MoveRecord& record) { return record; }
 
         void randomizeHiddenState() {};
     };
+
+    // Tic-tac-toe has no hidden information, the information set of a player is the state itself
+    class State::InformationSet {
+    public:
+        int observer = 1;
+        int playerToMove = 1;
+
+        InformationSet(const State& state, int observer);
+
+        State sample(std::mt19937& rng) const;
+        void sample(State& state, std::mt19937& rng) const;
+        void makeMove(const Move& move);
+        bool isTerminal() const { return state.isTerminal(); }
+        bool isLegal(const Move& move) const { return state.isLegal(move); }
+
+        uint64_t canonicalKey() const { return state.key(); } // the board symmetries aren't reduced
+        uint64_t canonicalMove(const Move& move) const { return move.m; }
+        Move fromCanonicalMove(uint64_t packed) const;
+
+        int expectedMoves() const; // of the player to move
+        double criticality() const { return 1.0; }
+
+    private:
+        State state;
+    };
+
+    // The value of every position reachable from the empty board under perfect play, solved once by negamax
+    // over getMovesAndStates. Used to check the moves of the search
+    class Oracle {
+    public:
+        Oracle();
+
+        int value(const State& state) const; // 1 if the player to move wins, 0 for a draw, -1 if they lose
+        uint optimalMoves(const State& state) const; // the cells of the moves keeping the value
+        bool isOptimal(const State& state, State::Move move) const;
+
+        const std::vector<State>& positions() const { return reachable; } // the reachable non-terminal ones
+
+    private:
+        struct Entry {
+            int8_t value = 2; // 2 if the position isn't solved
+            uint16_t optimal = 0;
+        };
+
+        std::vector<Entry> table; // by State::key
+        std::vector<State> reachable;
+
+        int solve(const State& state);
+    };
 }
 
 namespace std {
@@ -81,4 +162,6 @@ namespace std {
     };
 }
 
+static_assert(checkGameState<ttt::State>(), "ttt::State must be a game for MCTS");
+
 #endif //TICTACTOE_TICTACTOE_H
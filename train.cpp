@@ -0,0 +1,137 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <random>
+#include <cmath>
+#include <algorithm>
+#include "Durak.h"
+#include "GameRecord.h"
+#include "DurakAgent.h"
+
+// Fits the weights of DurakSoftmaxAgent to the moves chosen by the searches in self-play records: every
+// position with a choice is a sample, the weights maximize the likelihood of the chosen moves by SGD.
+// The last tenth of the games is held out to report how often the agent's favourite move is the chosen one
+//   MCTSTrain <weights output> <records> [epochs] [learning rate]
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " <weights output> <records> [epochs] [learning rate]" << std::endl;
+        return 1;
+    }
+
+    std::string output = argv[1];
+    GameRecordReader reader(argv[2]);
+    size_t epochs = argc > 3 ? std::stoul(argv[3]) : 10;
+    double rate = argc > 4 ? std::stod(argv[4]) : 0.01;
+    const double l2 = 1e-4;
+
+    struct Sample {
+        std::vector<DurakSoftmaxAgent::Features> moves;
+        size_t chosen;
+    };
+
+    std::vector<Sample> train, test;
+
+    for (size_t game = 0; game < reader.size(); ++game) {
+        GameRecord record = reader[game].record();
+        DurakState state = record.initial;
+        std::vector<Sample>& samples = game < reader.size() - reader.size() / 10 ? train : test;
+
+        for (const GameRecord::MoveStats& stats : record.moves) {
+            DurakState::MoveGenerator generator = state.moveGenerator();
+
+            if (generator.size() > 1) {
+                DurakSoftmaxAgent::Context context = DurakSoftmaxAgent::context(state);
+                Sample sample{{}, generator.size()};
+
+                for (size_t i = 0; i < generator.size(); ++i) {
+                    sample.moves.push_back(DurakSoftmaxAgent::features(context, generator.kind(i), generator.cards(i)));
+
+                    if ((static_cast<uint64_t>(generator.kind(i)) << 60 | generator.cards(i)) == stats.move.packed)
+                        sample.chosen = i;
+                }
+
+                // a legal move the generator doesn't make, e.g. a defend pairing the cards differently,
+                // reused by the search from another determinization
+                if (sample.chosen == generator.size())
+                    sample.moves.push_back(DurakSoftmaxAgent::features(
+                            context, static_cast<DurakState::MoveKind>(stats.move.packed >> 60),
+                            stats.move.packed & ((1ull << 60) - 1)));
+
+                samples.push_back(std::move(sample));
+            }
+
+            state.makeMove(DurakState::restoreMove(stats.move));
+        }
+    }
+
+    std::cerr << reader.size() << " games, " << train.size() << " training and " << test.size() << " test positions"
+              << std::endl;
+
+    DurakSoftmaxAgent agent;
+    std::vector<float> probabilities;
+
+    // the probabilities of the moves of a sample under the current weights
+    auto predict = [&](const Sample& sample) {
+        probabilities.resize(sample.moves.size());
+        float max = 0, sum = 0;
+
+        for (size_t i = 0; i < sample.moves.size(); ++i) {
+            probabilities[i] = agent.score(sample.moves[i]);
+            max = i ? std::max(max, probabilities[i]) : probabilities[i];
+        }
+
+        for (float& p : probabilities)
+            sum += p = std::exp(p - max);
+
+        for (float& p : probabilities)
+            p /= sum;
+    };
+
+    auto accuracy = [&](const std::vector<Sample>& samples) {
+        size_t right = 0;
+
+        for (const Sample& sample : samples) {
+            predict(sample);
+            right += std::max_element(probabilities.begin(), probabilities.end()) - probabilities.begin() ==
+                     static_cast<std::ptrdiff_t>(sample.chosen);
+        }
+
+        return samples.empty() ? 0 : static_cast<double>(right) / samples.size();
+    };
+
+    std::mt19937 rng(5);
+    std::vector<size_t> order(train.size());
+    for (size_t i = 0; i < order.size(); ++i)
+        order[i] = i;
+
+    for (size_t epoch = 1; epoch <= epochs; ++epoch) {
+        std::shuffle(order.begin(), order.end(), rng);
+        double loss = 0;
+
+        for (size_t i : order) {
+            const Sample& sample = train[i];
+            predict(sample);
+            loss -= std::log(std::max(probabilities[sample.chosen], 1e-30f));
+
+            // the gradient of the log-likelihood is the chosen features minus the expected ones
+            for (size_t j = 0; j < sample.moves.size(); ++j) {
+                float step = rate * ((j == sample.chosen) - probabilities[j]);
+
+                for (size_t k = 0; k < sample.moves[j].size; ++k)
+                    agent.weights[sample.moves[j].items[k].first] += step * sample.moves[j].items[k].second;
+            }
+
+            for (float& weight : agent.weights)
+                weight -= rate * l2 * weight;
+        }
+
+        std::cerr << "Epoch " << epoch << ": loss " << loss / std::max<size_t>(train.size(), 1)
+                  << ", test accuracy " << accuracy(test) << std::endl;
+    }
+
+    DurakSoftmaxAgent::save(output, agent.weights);
+    std::cout << "Saved " << output << ", training accuracy " << accuracy(train) << ", test accuracy "
+              << accuracy(test) << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,165 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <array>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <fstream>
+#include "Durak.h"
+#include "MCTS.h"
+#include "DurakAgent.h"
+#include "EngineConfig.h"
+
+// the engine of MCTS and its server, so that the settings are tuned for the rollouts they are used with
+using Engine = MCTS<DurakState, DurakSoftmaxAgent>;
+using Clock = std::chrono::steady_clock;
+
+// a tuned setting: the config field, its bounds and the size of a perturbation at the start
+struct Parameter {
+    double EngineConfig::* field;
+    double min, max;
+    double step;
+};
+
+// searches for a fixed time, so that the settings are compared at the same cost whatever they do to the speed
+DurakState::Move timedMove(const Engine& engine, Clock::duration budget) {
+    StopSource stop;
+    Clock::time_point deadline = Clock::now() + budget;
+
+    return engine.getMove(SIZE_MAX, stop.token(), [&stop, deadline](const Engine::Progress&) {
+        if (Clock::now() >= deadline)
+            stop.requestStop();
+    }, 64);
+}
+
+// plays the deal DurakState(seed) between two configs, returns 1 if the first one wins, -1 if the second
+// one does and 0 for a draw
+int play(const EngineConfig& first, const EngineConfig& second, const DurakSoftmaxAgent::Weights& weights,
+         int firstPlayer, size_t seed, Clock::duration budget) {
+    DurakState state(seed);
+    std::vector<Engine> engines;
+
+    for (int player = 1; player <= state.numberOfPlayers; ++player) {
+        const EngineConfig& config = player == firstPlayer ? first : second;
+        engines.emplace_back(config.exploration, state.informationSet(player), DurakSoftmaxAgent(weights),
+                             config.widening, config.wideningExponent);
+        engines.back().rave = config.rave;
+        engines.back().output = nullptr;
+    }
+
+    while (!state.isTerminal()) {
+        DurakState::Move move = timedMove(engines.at(state.playerToMove - 1), budget);
+        state.makeMove(move);
+
+        for (int observer = 1; observer <= state.numberOfPlayers; ++observer) {
+            engines.at(observer - 1).makeMove(move, state.informationSet(observer));
+            engines.at(observer - 1).compact();
+        }
+    }
+
+    for (int player = 1; player <= state.numberOfPlayers; ++player)
+        if (state.getResult(player) == 1)
+            return player == firstPlayer ? 1 : -1;
+
+    return 0;
+}
+
+// Tunes the engine settings by SPSA: every iteration perturbs all the settings at once in random directions,
+// plays games between the two opposite perturbations and moves the settings along the estimated gradient
+// of the score. The games of an iteration are played in pairs on the same deal with the seats swapped.
+// The config is saved after every iteration, an existing config is the starting point. --weights loads the
+// rollout weights of MCTSTrain the engine will play with, without them the rollouts are random
+//   MCTSTune [--weights <path>] <config> [iterations] [games per iteration] [milliseconds per move] [threads]
+int main(int argc, char** argv) {
+    DurakSoftmaxAgent::Weights weights{};
+
+    if (argc > 2 && std::string(argv[1]) == "--weights") {
+        weights = DurakSoftmaxAgent::load(argv[2]);
+        argc -= 2;
+        argv += 2;
+    }
+
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " [--weights <path>] <config> [iterations] [games per iteration] "
+                  << "[milliseconds per move] [threads]" << std::endl;
+        return 1;
+    }
+
+    std::string path = argv[1];
+    size_t iterations = argc > 2 ? std::stoul(argv[2]) : 100;
+    size_t games = argc > 3 ? std::stoul(argv[3]) : 8;
+
+    // the games go in pairs of swapped seats, and the score is divided by their number
+    if (games < 2) {
+        std::cerr << "There must be at least 2 games per iteration" << std::endl;
+        return 1;
+    }
+
+    games = games / 2 * 2;
+    std::chrono::milliseconds budget(argc > 4 ? std::stoul(argv[4]) : 50);
+    size_t threads = argc > 5 ? std::stoul(argv[5]) : std::thread::hardware_concurrency();
+
+    EngineConfig config = std::ifstream(path) ? EngineConfig::load(path) : EngineConfig();
+
+    const std::vector<Parameter> parameters = {
+            {&EngineConfig::exploration, 0.05, 3.0, 0.15},
+            {&EngineConfig::widening, 0, 8.0, 0.25},
+            {&EngineConfig::wideningExponent, 0.1, 1.0, 0.08},
+            {&EngineConfig::rave, 0, 2000, 50},
+    };
+
+    // the usual SPSA gains: a_k = a / (A + k)^0.602, c_k = 1 / k^0.101 in the units of the steps
+    const double a = 2.0, A = iterations / 10.0;
+    std::mt19937 rng(5);
+
+    for (size_t k = 1; k <= iterations; ++k) {
+        double ak = a / std::pow(A + k, 0.602), ck = 1 / std::pow(k, 0.101);
+
+        std::vector<int> delta(parameters.size());
+        EngineConfig plus = config, minus = config;
+
+        for (size_t i = 0; i < parameters.size(); ++i) {
+            const Parameter& p = parameters[i];
+            delta[i] = std::bernoulli_distribution()(rng) ? 1 : -1;
+            plus.*p.field = std::clamp(config.*p.field + ck * p.step * delta[i], p.min, p.max);
+            minus.*p.field = std::clamp(config.*p.field - ck * p.step * delta[i], p.min, p.max);
+        }
+
+        std::atomic<size_t> next(0);
+        std::atomic<int> score(0); // of plus against minus
+
+        auto work = [&] {
+            for (size_t game = next++; game < games; game = next++)
+                score += play(plus, minus, weights, 1 + game % 2, k * games + game / 2, budget);
+        };
+
+        std::vector<std::thread> workers;
+        for (size_t i = 0; i < std::max<size_t>(std::min(threads, games), 1); ++i)
+            workers.emplace_back(work);
+
+        for (std::thread& worker : workers)
+            worker.join();
+
+        // the gradient estimate along a setting is score / (2 c_k delta), the step is taken in its units
+        double result = static_cast<double>(score) / games;
+
+        for (size_t i = 0; i < parameters.size(); ++i) {
+            const Parameter& p = parameters[i];
+            double gradient = result / (2 * ck * delta[i]);
+            config.*p.field = std::clamp(config.*p.field + ak * gradient * p.step, p.min, p.max);
+        }
+
+        config.save(path);
+
+        std::cerr << "Iteration " << k << "/" << iterations << ": score " << score << "/" << games;
+        for (const auto& [name, field] : EngineConfig::fields())
+            std::cerr << ", " << name << " " << config.*field;
+        std::cerr << std::endl;
+    }
+
+    return 0;
+}